@@ -6,17 +6,39 @@
 
 #include "DocumentLink.h"
 
+// Caller-owned pixels, e.g. a pooled buffer or shared memory, must outlive the render.
+// Rows are at least Size.width() pixels of Format long; mono and indexed formats are not supported.
+struct DocumentRenderTarget
+{
+    uchar* Data;
+    QSize Size;
+    qsizetype BytesPerLine;
+    QImage::Format Format;
+};
+
 struct Document
 {
     virtual ~Document() = default;
 
     virtual auto pageCount() const -> std::size_t = 0;
     virtual auto pagePointSize(int page) const -> QSizeF = 0;
+    virtual auto isPageSizeKnown(int page) const -> bool = 0; // until then the size is a placeholder, e.g. while loading
 
     virtual auto text(int page, int from = 0, int count = -1) const -> QString = 0;
     virtual auto textBoxes(int page, int from = 0, int count = -1) const -> QList<QRectF> = 0;
 
     virtual auto render(int page, qreal scale) const -> QFuture<QImage> = 0;
+    virtual auto render(int page, const DocumentRenderTarget& target) const -> QFuture<void> = 0; // canceled on failure or an unusable target
+
+    // NOTE: results are parts of the page image, each one's offset() is its position: bands from top to bottom,
+    // the last result may cover the whole page; only the results together are the page image
+    virtual auto renderBands(int page, qreal scale, int bandHeight) const -> QFuture<QImage> = 0;
 
     virtual auto links(int page) const -> QList<DocumentLink> = 0;
+
+    // NOTE: expected render time in ms per megapixel, measured on the page or averaged over the document, 0 if unknown
+    virtual auto renderCost(int page) const -> qreal = 0;
+
+    // NOTE: identifies the document contents for persistent caches, empty if unknown; might be slow on the first call
+    virtual auto fingerprint() const -> QByteArray = 0;
 };
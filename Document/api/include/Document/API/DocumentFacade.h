@@ -4,12 +4,16 @@
 #include <QtGui/QImage>
 
 #include "DocumentLink.h"
+#include "DocumentSearch.h"
 
 struct Document;
 struct DocumentRenderFeedback;
 struct DocumentRenderer;
 struct DocumentParser;
+struct DocumentParserFeedback;
+struct DocumentHit;
 struct DocumentTextRegion;
+struct DocumentTextSelection;
 
 class DocumentFacade
 {
@@ -21,25 +25,45 @@ public:
 
     auto setParser(const std::shared_ptr<DocumentParser>& parser) -> void;
     auto setRenderer(const std::shared_ptr<DocumentRenderer>& renderer) -> void;
+    auto setSearch(const std::shared_ptr<DocumentSearch>& search) -> void;
 
-    // TODO: refactor this
-    auto setRenderFeedback(DocumentRenderFeedback* feedback) -> void;
+    // NOTE: every view registers its own feedbacks and removes them before they are destroyed
+    auto addRenderFeedback(DocumentRenderFeedback* feedback) -> void;
+    auto removeRenderFeedback(DocumentRenderFeedback* feedback) -> void;
+    auto addParserFeedback(DocumentParserFeedback* feedback) -> void;
+    auto removeParserFeedback(DocumentParserFeedback* feedback) -> void;
 
     auto pageCount() const -> int;
     auto pageSize(int number) const -> QSizeF;
 
-    auto requestImage(int number, qreal scale) const -> std::optional<QImage>;
+    auto requestImage(int number, qreal scale, qreal pixelRatio, DocumentRenderFeedback* feedback) const -> std::optional<QImage>;
+    auto requestThumbnail(int number) const -> std::optional<QImage>;
+
+    auto isLayoutReady(int page) const -> bool;
+    auto prefetchLayout(int page) const -> void;
+    auto whenLayoutReady(int page) const -> QFuture<void>;
 
     auto linkHit(int page, QPointF point) const -> bool;
     auto link(int page, QPointF point) const -> std::optional<DocumentLink>;
+    auto link(int page, int32_t id) const -> std::optional<DocumentLink>;
+
+    auto hitTest(int page, QPointF point, uint8_t lod = -1) const -> DocumentHit;
 
     auto textHit(int page, QPointF point, uint8_t lod = -1) const -> bool;
     auto textRegion() const -> std::unique_ptr<DocumentTextRegion>;
+    auto textSelection() const -> std::unique_ptr<DocumentTextSelection>;
+    auto textGeometry(int page, int from, int count) const -> QList<QRectF>;
+
+    auto find(const QString& query) const -> QFuture<DocumentSearchHit>;
 
 private:
+    struct ParserFeedbacks;
+
     std::shared_ptr<Document> m_document;
+    std::unique_ptr<ParserFeedbacks> m_parserFeedbacks;
 
     std::shared_ptr<DocumentParser> m_parser;
     std::shared_ptr<DocumentRenderer> m_renderer;
-    DocumentRenderFeedback* m_rendererFeedback = nullptr;
+    std::shared_ptr<DocumentSearch> m_search;
+    QList<DocumentRenderFeedback*> m_renderFeedbacks;
 };
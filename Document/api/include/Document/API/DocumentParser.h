@@ -1,11 +1,24 @@
 #pragma once
 
+#include <QFuture>
 #include <QRectF>
 
 #include "DocumentLink.h"
 
 struct Document;
 
+// Level of detail of text queries: coarser levels are cheaper, any value above Char means Char
+namespace DocumentTextLoD
+{
+    enum : uint8_t
+    {
+        Block = 0,
+        Line = 1,
+        Word = 2,
+        Char = 3,
+    };
+}
+
 struct DocumentTextRegion
 {
     virtual ~DocumentTextRegion() = default;
@@ -19,15 +32,66 @@ struct DocumentTextRegion
     virtual auto geometry() const -> QList<QRectF> = 0;
 };
 
+// Page areas to repaint: (page, rectangle in page coordinates), the null rectangle means the whole page
+using DocumentDirtyRegion = QList<std::pair<int, QRectF>>;
+
+// Stateful text selection: the anchor is resolved once, then only cursor movements are applied,
+// touching the lines and pages between the previous and the new cursor positions.
+struct DocumentTextSelection
+{
+    virtual ~DocumentTextSelection() = default;
+
+    virtual auto setAnchor(int page, QPointF point, uint8_t lod = -1) -> DocumentDirtyRegion = 0;
+    virtual auto moveCursor(int page, QPointF point) -> DocumentDirtyRegion = 0;
+    virtual auto clear() -> DocumentDirtyRegion = 0;
+
+    // Re-resolves anchor and cursor, e.g. when their pages' layouts became ready
+    virtual auto refresh() -> DocumentDirtyRegion = 0;
+
+    virtual auto isEmpty() const -> bool = 0;
+
+    virtual auto text() const -> QString = 0;
+    virtual auto geometry(int page) const -> QList<QRectF> = 0;
+};
+
+// What is under the point: links take precedence over text, Link and Line are -1 if none
+struct DocumentHit
+{
+    enum class Kind : uint8_t { None, Text, Link };
+
+    Kind Type = Kind::None;
+    int32_t Link = -1; // page-wide link id, see DocumentParser::link
+    int32_t Line = -1;
+};
+
+struct DocumentParserFeedback
+{
+    virtual ~DocumentParserFeedback() = default;
+
+    virtual void layoutReady(int page) const = 0;
+};
+
 struct DocumentParser
 {
     virtual ~DocumentParser() = default;
 
     virtual auto setDocument(std::shared_ptr<const Document> document) -> void = 0;
+    virtual auto setFeedback(DocumentParserFeedback* feedback) -> void = 0;
+
+    // NOTE: queries below never block; until the page layout is ready they report "nothing" (see isReady)
+    virtual auto isReady(int page) const -> bool = 0;
+    virtual auto prefetch(int page) const -> void = 0;
+    virtual auto whenReady(int page) const -> QFuture<void> = 0; // canceled if the layout will never be ready
 
     virtual auto textHit(int page, QPointF point, uint8_t lod = -1) const -> bool = 0;
     virtual auto textRegion() const -> std::unique_ptr<DocumentTextRegion> = 0;
+    virtual auto textSelection() const -> std::unique_ptr<DocumentTextSelection> = 0;
+    virtual auto textGeometry(int page, int from, int count) const -> QList<QRectF> = 0;
 
     virtual auto linkHit(int page, QPointF point) const -> bool = 0;
     virtual auto link(int page, QPointF point) const -> std::optional<DocumentLink> = 0;
+    virtual auto link(int page, int32_t id) const -> std::optional<DocumentLink> = 0;
+
+    // NOTE: cheap enough to be called on every pointer move, does not allocate
+    virtual auto hitTest(int page, QPointF point, uint8_t lod = -1) const -> DocumentHit = 0;
 };
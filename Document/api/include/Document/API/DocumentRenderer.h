@@ -19,5 +19,17 @@ struct DocumentRenderer
 
     virtual auto setDocument(std::shared_ptr<const Document> document) -> void = 0;
 
-    virtual auto requestPageRender(int page, qreal scale, DocumentRenderFeedback* feedback) const -> std::optional<QImage> = 0;
+    // NOTE: a feedback must be removed before it is destroyed, requests of several feedbacks are shared
+    virtual auto addFeedback(DocumentRenderFeedback* feedback) -> void = 0;
+    virtual auto removeFeedback(DocumentRenderFeedback* feedback) -> void = 0;
+
+    // Text key of an image that is still being composed, e.g. a large page rendered in bands; such an image
+    // changes with every part drawn into it, so it is not worth caching its copies
+    static constexpr auto PartialImageKey = "DocumentPartialImage";
+
+    // NOTE: the image is rendered at scale * pixelRatio, the pixel ratio of the screen it is painted on
+    virtual auto requestPageRender(int page, qreal scale, qreal pixelRatio, DocumentRenderFeedback* feedback) const -> std::optional<QImage> = 0;
+
+    // NOTE: thumbnails of all pages are rendered in the background, nullopt until the page's one is ready
+    virtual auto requestThumbnail(int page) const -> std::optional<QImage> = 0;
 };
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <memory>
+
+#include <QFuture>
+#include <QString>
+
+struct Document;
+
+// Characters [From; From + Count) of the page text, see DocumentParser::textGeometry for their rectangles
+struct DocumentSearchHit
+{
+    int Page;
+    int From;
+    int Count;
+};
+
+struct DocumentSearch
+{
+    virtual ~DocumentSearch() = default;
+
+    virtual auto setDocument(std::shared_ptr<const Document> document) -> void = 0;
+
+    // NOTE: hits are streamed as the future's results in page order, even while the document is still being indexed
+    virtual auto find(const QString& query) const -> QFuture<DocumentSearchHit> = 0;
+};
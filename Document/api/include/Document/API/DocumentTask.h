@@ -0,0 +1,302 @@
+#pragma once
+
+#include <coroutine>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <type_traits>
+
+#include <QCoreApplication>
+#include <QFuture>
+#include <QFutureWatcher>
+#include <QHash>
+#include <QMutex>
+#include <QPromise>
+#include <QThread>
+#include <QThreadPool>
+
+#include "Document.h"
+
+// Cancellation shared by a coroutine and whoever has started it.
+//
+// Canceling the token cancels the future the coroutine is awaiting at the moment, which reaches the
+// backend (e.g. QPdfDocument::ICancel of a render) and lets the coroutine resume at once.
+class DocumentCancelToken
+{
+public:
+    DocumentCancelToken()
+        : d(std::make_shared<State>())
+    {}
+
+    void cancel() const
+    {
+        QList<std::function<void()>> callbacks;
+
+        {
+            const QMutexLocker locker(&d->Mutex);
+
+            if (d->Canceled)
+                return;
+
+            d->Canceled = true;
+            callbacks = d->Callbacks.values();
+            d->Callbacks.clear();
+        }
+
+        for (const std::function<void()>& callback : callbacks)
+            callback();
+    }
+
+    [[nodiscard]] bool isCanceled() const
+    {
+        const QMutexLocker locker(&d->Mutex);
+        return d->Canceled;
+    }
+
+    // NOTE: the callback is called at once if the token is canceled already, -1 is returned then
+    int subscribe(std::function<void()> callback) const
+    {
+        {
+            const QMutexLocker locker(&d->Mutex);
+
+            if (!d->Canceled)
+            {
+                d->Callbacks.insert(++d->LastId, std::move(callback));
+                return d->LastId;
+            }
+        }
+
+        callback();
+        return -1;
+    }
+
+    void unsubscribe(const int id) const
+    {
+        const QMutexLocker locker(&d->Mutex);
+        d->Callbacks.remove(id);
+    }
+
+private:
+    struct State
+    {
+        QMutex Mutex;
+        bool Canceled = false;
+        int LastId = 0;
+        QHash<int, std::function<void()>> Callbacks;
+    };
+
+    std::shared_ptr<State> d;
+};
+
+template<typename T>
+class DocumentTask;
+
+namespace DocumentTaskDetail
+{
+    // Resumes the coroutine in the awaiting thread if it runs an event loop, otherwise in the thread that
+    // finishes the future. The result is std::optional<U> (bool for void), empty (false) if canceled.
+    template<typename U>
+    struct FutureAwaiter
+    {
+        QFuture<U> Future;
+        DocumentCancelToken Token;
+        int Subscription = -1;
+
+        bool await_ready() const
+        {
+            return Future.isFinished();
+        }
+
+        void await_suspend(std::coroutine_handle<> handle)
+        {
+            Subscription = Token.subscribe([future = Future]() mutable { future.cancel(); });
+
+            QThread* thread = QThread::currentThread();
+
+            if (thread->eventDispatcher())
+            {
+                Future
+                    .then(thread, [handle](QFuture<U>) { handle.resume(); })
+                    .onCanceled(thread, [handle] { handle.resume(); });
+            }
+            else
+            {
+                Future
+                    .then(QtFuture::Launch::Sync, [handle](QFuture<U>) { handle.resume(); })
+                    .onCanceled([handle] { handle.resume(); });
+            }
+        }
+
+        auto await_resume()
+        {
+            Token.unsubscribe(Subscription);
+
+            if constexpr (std::is_void_v<U>)
+            {
+                return !Future.isCanceled();
+            }
+            else
+            {
+                return !Future.isCanceled() && Future.resultCount() > 0
+                    ? std::optional<U>(Future.result())
+                    : std::optional<U>();
+            }
+        }
+    };
+
+    template<typename T>
+    struct PromiseBase
+    {
+        // The token is taken from the coroutine parameters, if there is one
+        template<typename... Args>
+        explicit PromiseBase(const Args&... args)
+        {
+            (take(args), ...);
+            Promise.start();
+            forwardCancellation();
+        }
+
+        DocumentTask<T> get_return_object()
+        {
+            return DocumentTask<T>(Promise.future(), Token);
+        }
+
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+
+        void unhandled_exception()
+        {
+            Promise.setException(std::current_exception());
+            Promise.finish();
+        }
+
+        template<typename U>
+        FutureAwaiter<U> await_transform(QFuture<U> future)
+        {
+            // Canceling the task's future before the watcher has told about it
+            if (Promise.isCanceled())
+                Token.cancel();
+
+            return { std::move(future), Token };
+        }
+
+        template<typename U>
+        FutureAwaiter<U> await_transform(const DocumentTask<U>& task)
+        {
+            return await_transform(task.future());
+        }
+
+        QPromise<T> Promise;
+        DocumentCancelToken Token;
+
+    private:
+        // Canceling the task's future reaches the token, and so the future being awaited, at once
+        // NOTE: the watcher needs an event loop, so it lives in the application's thread and deletes itself when the task finishes
+        void forwardCancellation()
+        {
+            const QCoreApplication* application = QCoreApplication::instance();
+
+            if (!application)
+                return;
+
+            auto* watcher = new QFutureWatcher<T>();
+            QObject::connect(watcher, &QFutureWatcherBase::canceled, watcher, [token = Token] { token.cancel(); });
+            QObject::connect(watcher, &QFutureWatcherBase::finished, watcher, &QObject::deleteLater);
+            watcher->setFuture(Promise.future());
+            watcher->moveToThread(application->thread());
+        }
+
+        void take(const DocumentCancelToken& token) { Token = token; }
+
+        template<typename U>
+        void take(const U&) {}
+    };
+}
+
+// Coroutine producing a QFuture: QFutures (and other tasks) are co_awaited without blocking any thread.
+//
+//   DocumentTask<QImage> renderFirstPage(std::shared_ptr<const Document> document, DocumentCancelToken token)
+//   {
+//       const std::optional<QImage> image = co_await document->render(0, 1.0);
+//       co_return image.value_or(QImage());
+//   }
+//
+// NOTE: the coroutine starts at once and its frame is gone when it finishes, so its parameters must be held by value
+template<typename T>
+class DocumentTask
+{
+public:
+    struct promise_type : DocumentTaskDetail::PromiseBase<T>
+    {
+        using DocumentTaskDetail::PromiseBase<T>::PromiseBase;
+
+        template<typename U>
+        void return_value(U&& value)
+        {
+            this->Promise.addResult(std::forward<U>(value));
+            this->Promise.finish();
+        }
+    };
+
+    DocumentTask(QFuture<T> future, DocumentCancelToken token)
+        : m_future(std::move(future))
+        , m_token(std::move(token))
+    {}
+
+    [[nodiscard]] QFuture<T> future() const { return m_future; }
+
+    void cancel() const { m_token.cancel(); }
+
+private:
+    QFuture<T> m_future;
+    DocumentCancelToken m_token;
+};
+
+template<>
+struct DocumentTask<void>::promise_type : DocumentTaskDetail::PromiseBase<void>
+{
+    using DocumentTaskDetail::PromiseBase<void>::PromiseBase;
+
+    void return_void()
+    {
+        Promise.finish();
+    }
+};
+
+// Awaitable versions of the blocking document queries, they run on the global thread pool
+namespace DocumentAsync
+{
+    template<typename Function, typename Result = std::invoke_result_t<Function>>
+    QFuture<Result> run(Function function)
+    {
+        auto promise = std::make_shared<QPromise<Result>>();
+        QFuture<Result> future = promise->future();
+
+        promise->start();
+
+        QThreadPool::globalInstance()->start([promise, function = std::move(function)]
+        {
+            if (!promise->isCanceled())
+                promise->addResult(function());
+
+            promise->finish();
+        });
+
+        return future;
+    }
+
+    inline QFuture<QImage> render(const std::shared_ptr<const Document>& document, const int page, const qreal scale)
+    {
+        return document->render(page, scale);
+    }
+
+    inline QFuture<QList<QRectF>> textBoxes(const std::shared_ptr<const Document>& document, const int page, const int from = 0, const int count = -1)
+    {
+        return run([document, page, from, count] { return document->textBoxes(page, from, count); });
+    }
+
+    inline QFuture<QList<DocumentLink>> links(const std::shared_ptr<const Document>& document, const int page)
+    {
+        return run([document, page] { return document->links(page); });
+    }
+}
@@ -4,11 +4,26 @@
 #include "DocumentRenderer.h"
 #include "DocumentParser.h"
 
+#include <QPromise>
+
 namespace
 {
     struct DummyParser : DocumentParser
     {
         auto setDocument(std::shared_ptr<const Document>) -> void final {}
+        auto setFeedback(DocumentParserFeedback*) -> void final {}
+
+        auto isReady(int) const -> bool final { return false; }
+        auto prefetch(int) const -> void final {}
+
+        auto whenReady(int) const -> QFuture<void> final
+        {
+            QPromise<void> promise;
+            promise.start();
+            promise.future().cancel();
+            promise.finish();
+            return promise.future();
+        }
 
         auto textHit(int, QPointF, uint8_t) const -> bool final { return false; }
 
@@ -26,21 +41,73 @@ namespace
             return std::make_unique<DummyTextRegion>();
         }
 
+        auto textSelection() const -> std::unique_ptr<DocumentTextSelection> final
+        {
+            struct DummyTextSelection : DocumentTextSelection
+            {
+                auto setAnchor(int, QPointF, uint8_t) -> DocumentDirtyRegion final { return {}; }
+                auto moveCursor(int, QPointF) -> DocumentDirtyRegion final { return {}; }
+                auto clear() -> DocumentDirtyRegion final { return {}; }
+                auto refresh() -> DocumentDirtyRegion final { return {}; }
+                auto isEmpty() const -> bool final { return true; }
+                auto text() const -> QString final { return {}; }
+                auto geometry(int) const -> QList<QRectF> final { return {}; }
+            };
+
+            return std::make_unique<DummyTextSelection>();
+        }
+
+        auto textGeometry(int, int, int) const -> QList<QRectF> final { return {}; }
+
         auto linkHit(int, QPointF) const -> bool override { return false; }
         auto link(int, QPointF) const -> std::optional<DocumentLink> override { return std::nullopt; }
+        auto link(int, int32_t) const -> std::optional<DocumentLink> override { return std::nullopt; }
+
+        auto hitTest(int, QPointF, uint8_t) const -> DocumentHit override { return {}; }
+    };
+
+    struct DummySearch : DocumentSearch
+    {
+        auto setDocument(std::shared_ptr<const Document>) -> void final {}
+
+        auto find(const QString&) const -> QFuture<DocumentSearchHit> final
+        {
+            QPromise<DocumentSearchHit> promise;
+            promise.start();
+            promise.finish();
+            return promise.future();
+        }
     };
 
     struct DummyRenderer : DocumentRenderer
     {
         auto setDocument(std::shared_ptr<const Document>) -> void final {}
 
-        auto requestPageRender(int page, qreal scale, DocumentRenderFeedback* feedback) const -> std::optional<QImage> override { return std::nullopt; }
+        auto addFeedback(DocumentRenderFeedback*) -> void final {}
+        auto removeFeedback(DocumentRenderFeedback*) -> void final {}
+
+        auto requestPageRender(int page, qreal scale, qreal pixelRatio, DocumentRenderFeedback* feedback) const -> std::optional<QImage> override { return std::nullopt; }
+        auto requestThumbnail(int page) const -> std::optional<QImage> override { return std::nullopt; }
     };
 }
 
+// Parser reports to a single feedback, it is shared by all the views
+struct DocumentFacade::ParserFeedbacks : DocumentParserFeedback
+{
+    void layoutReady(const int page) const final
+    {
+        for (const DocumentParserFeedback* feedback : List)
+            feedback->layoutReady(page);
+    }
+
+    QList<DocumentParserFeedback*> List;
+};
+
 DocumentFacade::DocumentFacade()
-    : m_parser(std::make_shared<DummyParser>())
+    : m_parserFeedbacks(std::make_unique<ParserFeedbacks>())
+    , m_parser(std::make_shared<DummyParser>())
     , m_renderer(std::make_shared<DummyRenderer>())
+    , m_search(std::make_shared<DummySearch>())
 {}
 
 DocumentFacade::~DocumentFacade() = default;
@@ -54,23 +121,60 @@ auto DocumentFacade::setDocument(const std::shared_ptr<Document>& document) -> v
 
     if (m_renderer)
         m_renderer->setDocument(document);
+
+    if (m_search)
+        m_search->setDocument(document);
 }
 
 auto DocumentFacade::setParser(const std::shared_ptr<DocumentParser>& parser) -> void
 {
     m_parser = parser;
+    m_parser->setFeedback(m_parserFeedbacks.get());
     m_parser->setDocument(m_document);
 }
 
 auto DocumentFacade::setRenderer(const std::shared_ptr<DocumentRenderer>& renderer) -> void
 {
+    for (DocumentRenderFeedback* feedback : std::as_const(m_renderFeedbacks))
+    {
+        m_renderer->removeFeedback(feedback);
+        renderer->addFeedback(feedback);
+    }
+
     m_renderer = renderer;
     m_renderer->setDocument(m_document);
 }
 
-auto DocumentFacade::setRenderFeedback(DocumentRenderFeedback* feedback) -> void
+auto DocumentFacade::setSearch(const std::shared_ptr<DocumentSearch>& search) -> void
+{
+    m_search = search;
+    m_search->setDocument(m_document);
+}
+
+auto DocumentFacade::addRenderFeedback(DocumentRenderFeedback* feedback) -> void
 {
-    m_rendererFeedback = feedback;
+    if (m_renderFeedbacks.contains(feedback))
+        return;
+
+    m_renderFeedbacks.append(feedback);
+    m_renderer->addFeedback(feedback);
+}
+
+auto DocumentFacade::removeRenderFeedback(DocumentRenderFeedback* feedback) -> void
+{
+    m_renderFeedbacks.removeAll(feedback);
+    m_renderer->removeFeedback(feedback);
+}
+
+auto DocumentFacade::addParserFeedback(DocumentParserFeedback* feedback) -> void
+{
+    if (!m_parserFeedbacks->List.contains(feedback))
+        m_parserFeedbacks->List.append(feedback);
+}
+
+auto DocumentFacade::removeParserFeedback(DocumentParserFeedback* feedback) -> void
+{
+    m_parserFeedbacks->List.removeAll(feedback);
 }
 
 auto DocumentFacade::pageCount() const -> int
@@ -83,9 +187,29 @@ auto DocumentFacade::pageSize(int number) const -> QSizeF
     return m_document->pagePointSize(number);
 }
 
-auto DocumentFacade::requestImage(int number, qreal scale) const -> std::optional<QImage>
+auto DocumentFacade::requestImage(int number, qreal scale, qreal pixelRatio, DocumentRenderFeedback* feedback) const -> std::optional<QImage>
+{
+    return m_renderer->requestPageRender(number, scale, pixelRatio, feedback);
+}
+
+auto DocumentFacade::requestThumbnail(int number) const -> std::optional<QImage>
+{
+    return m_renderer->requestThumbnail(number);
+}
+
+auto DocumentFacade::isLayoutReady(int page) const -> bool
+{
+    return m_parser->isReady(page);
+}
+
+auto DocumentFacade::prefetchLayout(int page) const -> void
+{
+    m_parser->prefetch(page);
+}
+
+auto DocumentFacade::whenLayoutReady(int page) const -> QFuture<void>
 {
-    return m_renderer->requestPageRender(number, scale, m_rendererFeedback);
+    return m_parser->whenReady(page);
 }
 
 auto DocumentFacade::linkHit(int page, QPointF point) const -> bool
@@ -98,6 +222,16 @@ auto DocumentFacade::link(int page, QPointF point) const -> std::optional<Docume
     return m_parser->link(page, point);
 }
 
+auto DocumentFacade::link(int page, int32_t id) const -> std::optional<DocumentLink>
+{
+    return m_parser->link(page, id);
+}
+
+auto DocumentFacade::hitTest(int page, QPointF point, uint8_t lod) const -> DocumentHit
+{
+    return m_parser->hitTest(page, point, lod);
+}
+
 auto DocumentFacade::textHit(int page, QPointF point, uint8_t lod) const -> bool
 {
     return m_parser->textHit(page, point, lod);
@@ -107,3 +241,18 @@ auto DocumentFacade::textRegion() const -> std::unique_ptr<DocumentTextRegion>
 {
     return m_parser->textRegion();
 }
+
+auto DocumentFacade::textSelection() const -> std::unique_ptr<DocumentTextSelection>
+{
+    return m_parser->textSelection();
+}
+
+auto DocumentFacade::textGeometry(int page, int from, int count) const -> QList<QRectF>
+{
+    return m_parser->textGeometry(page, from, count);
+}
+
+auto DocumentFacade::find(const QString& query) const -> QFuture<DocumentSearchHit>
+{
+    return m_search->find(query);
+}
@@ -8,18 +8,33 @@ public:
     PdfDocument();
     ~PdfDocument() override;
 
+    // Links are extracted in the background after loading, so that they are ready when hovered;
+    // batch users that never ask for links turn it off before loading. On by default.
+    void setLinkPassEnabled(bool enabled);
+
     void load(const QString& path);
 
+    // NOTE: results are the pages whose sizes got known, the first page is reported alone and as soon as possible;
+    // QtPdf reads the whole file on load, so the first page comes only after that, however big the file is
+    auto loadAsync(const QString& path) -> QFuture<int>;
+
     auto pageCount() const -> std::size_t final;
     auto pagePointSize(int page) const -> QSizeF final;
+    auto isPageSizeKnown(int page) const -> bool final;
 
     auto text(int page, int from, int count) const -> QString final;
     auto textBoxes(int page, int from, int count) const -> QList<QRectF> final;
 
     auto render(int page, qreal scale) const -> QFuture<QImage> final;
+    auto render(int page, const DocumentRenderTarget& target) const -> QFuture<void> final;
+    auto renderBands(int page, qreal scale, int bandHeight) const -> QFuture<QImage> final;
 
     auto links(int page) const -> QList<DocumentLink> final;
 
+    auto renderCost(int page) const -> qreal final;
+
+    auto fingerprint() const -> QByteArray final;
+
 private:
     struct Private;
     std::unique_ptr<Private> d;
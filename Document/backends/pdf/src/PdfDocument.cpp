@@ -3,11 +3,266 @@
 #include <QtConcurrent/QtConcurrentRun>
 #include <QPdfDocument>
 #include <QPdfLinkModel>
+#include <QPdfDocumentRenderOptions>
 #include <QElapsedTimer>
+#include <QCryptographicHash>
+#include <QFile>
+#include <QMutex>
+#include <QPainter>
+#include <QThreadPool>
+
+#include <cstring>
+
+namespace
+{
+    constexpr int PageSizesBatch = 64;
+
+    template<typename T>
+    struct PromiseCancel : QPdfDocument::ICancel
+    {
+        explicit PromiseCancel(QPromise<T>& promise) : m_promise(promise) {}
+
+        bool isCancelled() final
+        {
+            return m_promise.isCanceled();
+        }
+
+    private:
+        QPromise<T>& m_promise;
+    };
+
+    // Render time per megapixel of every rendered page and of the whole document, the latter stands for pages not rendered yet.
+    // Both are moving averages, so they follow the changes of the machine load.
+    class RenderCostModel
+    {
+    public:
+        void reset()
+        {
+            const QMutexLocker locker(&m_mutex);
+            m_pages.clear();
+            m_average = 0.0;
+        }
+
+        void record(const int page, const QSize size, const qint64 nsecs)
+        {
+            const qreal area = qreal(size.width()) * size.height() / 1'000'000;
+
+            if (area < MinArea)
+                return;
+
+            const qreal cost = qreal(nsecs) / 1'000'000 / area;
+
+            const QMutexLocker locker(&m_mutex);
+
+            qreal& pageCost = m_pages[page];
+            pageCost = pageCost > 0.0 ? pageCost + PageWeight * (cost - pageCost) : cost;
+            m_average = m_average > 0.0 ? m_average + DocumentWeight * (cost - m_average) : cost;
+        }
+
+        [[nodiscard]] qreal cost(const int page) const
+        {
+            const QMutexLocker locker(&m_mutex);
+            return m_pages.value(page, m_average);
+        }
+
+    private:
+        static constexpr qreal MinArea = 0.25; // MPix, smaller renders are dominated by the fixed overhead
+        static constexpr qreal PageWeight = 0.5;
+        static constexpr qreal DocumentWeight = 0.1;
+
+        mutable QMutex m_mutex;
+        QHash<int, qreal> m_pages;
+        qreal m_average = 0.0;
+    };
+
+    // Negative count means "up to the end of the page", which the engine takes as the end index of -1
+    int endIndex(const int from, const int count)
+    {
+        return count < 0 ? -1 : from + count;
+    }
+
+    bool isUsable(const DocumentRenderTarget& target)
+    {
+        if (!target.Data || target.Size.isEmpty())
+            return false;
+
+        switch (target.Format)
+        {
+            case QImage::Format_Invalid:
+            case QImage::Format_Mono:
+            case QImage::Format_MonoLSB:
+            case QImage::Format_Indexed8:
+                return false;
+            default:
+                break;
+        }
+
+        const qsizetype rowSize = (qsizetype(target.Size.width()) * QImage::toPixelFormat(target.Format).bitsPerPixel() + 7) / 8;
+        return target.BytesPerLine >= rowSize;
+    }
+
+    QFuture<void> makeCanceledFuture()
+    {
+        QPromise<void> promise;
+        promise.start();
+        promise.future().cancel();
+        promise.finish();
+        return promise.future();
+    }
+
+    QByteArray fileFingerprint(const QString& path)
+    {
+        QFile file(path);
+
+        if (!file.open(QIODevice::ReadOnly))
+            return {};
+
+        QCryptographicHash hash(QCryptographicHash::Sha1);
+        return hash.addData(&file) ? hash.result() : QByteArray();
+    }
+}
 
 struct PdfDocument::Private
 {
+    Private()
+    {
+        linkPool.setMaxThreadCount(1);
+        linkPool.setThreadPriority(QThread::LowestPriority);
+    }
+
+    // Page sizes are published in page order, so sizes [0; knownSizes) are safe to read from any thread
+    void resetPageSizes(const int count)
+    {
+        knownSizes = 0;
+        pageSizes = QList<QSizeF>(count);
+        pageCount.store(count, std::memory_order_release);
+    }
+
+    void publishPageSize(const int page)
+    {
+        pageSizes[page] = doc.pagePointSize(page);
+        knownSizes.store(page + 1, std::memory_order_release);
+    }
+
+    // Links of a page are extracted once, either on demand or by the background pass, whichever comes first
+    void resetLinks(const int count)
+    {
+        linkPass.cancel();
+        linkPass.waitForFinished();
+
+        pageLinks = QList<QList<DocumentLink>>(count);
+        linkStates = std::make_unique<std::atomic_uint8_t[]>(count);
+    }
+
+    [[nodiscard]] const QList<DocumentLink>* findLinks(const int page) const
+    {
+        return linkStates[page].load(std::memory_order_acquire) == LinksReady ? &pageLinks[page] : nullptr;
+    }
+
+    void storeLinks(const int page, QList<DocumentLink> links)
+    {
+        uint8_t expected = LinksMissing;
+
+        // Somebody else has extracted the same links already
+        if (!linkStates[page].compare_exchange_strong(expected, LinksStoring, std::memory_order_acquire))
+            return;
+
+        pageLinks[page] = std::move(links);
+        linkStates[page].store(LinksReady, std::memory_order_release);
+    }
+
+    // TODO: get rid of QPdfLinkModel, links are to be enumerated by the patched Qt::Pdf directly
+    [[nodiscard]] QList<DocumentLink> extractLinks(QPdfLinkModel& model, const int page) const
+    {
+        model.setPage(page);
+
+        const int count = model.rowCount(QModelIndex());
+
+        QList<DocumentLink> links;
+        links.reserve(count);
+
+        for (int i = 0; i < count; ++i)
+        {
+            const QPdfLink link = model.data(model.index(i), static_cast<int>(QPdfLinkModel::Role::Link)).value<QPdfLink>();
+
+            if (link.url().isValid())
+                links.append({ page, link.rectangles(), DocumentLink::Url(link.url())});
+            else
+                links.append({ page, link.rectangles(), DocumentLink::Jump(link.page(), link.zoom(), link.location() )});
+        }
+
+        return links;
+    }
+
+    // A single model walks all the pages, the engine is serialized anyway; the pass has its own low priority
+    // thread, so it takes neither the slots of the renders on the global pool nor the cores from them
+    void startLinkPass(const int count)
+    {
+        if (!isLinkPassEnabled)
+            return;
+
+        linkPass = QtConcurrent::run(&linkPool, [this, count](QPromise<void>& promise)
+        {
+            QElapsedTimer timer;
+            timer.start();
+
+            QPdfLinkModel model;
+            model.setDocument(&doc);
+
+            for (int page = 0; page < count && !promise.isCanceled(); ++page)
+            {
+                if (!findLinks(page))
+                    storeLinks(page, extractLinks(model, page));
+            }
+
+            qDebug() << "Links extracted: pages =" << count << "time =" << timer.elapsed() << "ms";
+        });
+    }
+
+    // NOTE: QPdfDocument::load can not be interrupted, so this waits until the file is loaded
+    void cancelLoading()
+    {
+        loading.cancel();
+        loading.waitForFinished();
+    }
+
+    ~Private()
+    {
+        cancelLoading();
+
+        linkPass.cancel();
+        linkPass.waitForFinished();
+    }
+
+    void resetFingerprint(const QString& file)
+    {
+        const QMutexLocker locker(&fingerprintMutex);
+        path = file;
+        fingerprint.reset();
+    }
+
     QPdfDocument doc;
+    QFuture<int> loading;
+
+    // Hashing reads the whole file, so it is done only if somebody asks
+    QString path;
+    mutable std::optional<QByteArray> fingerprint;
+    mutable QMutex fingerprintMutex;
+
+    // NOTE: the document is loaded on a worker, so its page count is published here rather than read from it
+    std::atomic_int pageCount = 0;
+    QList<QSizeF> pageSizes;
+    std::atomic_int knownSizes = 0;
+
+    enum LinksState : uint8_t { LinksMissing, LinksStoring, LinksReady };
+
+    QList<QList<DocumentLink>> pageLinks;
+    std::unique_ptr<std::atomic_uint8_t[]> linkStates;
+    QThreadPool linkPool;
+    QFuture<void> linkPass;
+    std::atomic_bool isLinkPassEnabled = true;
+
+    RenderCostModel renderCosts;
 };
 
 PdfDocument::PdfDocument()
@@ -16,86 +271,260 @@ PdfDocument::PdfDocument()
 
 PdfDocument::~PdfDocument() = default;
 
+void PdfDocument::setLinkPassEnabled(const bool enabled)
+{
+    d->isLinkPassEnabled = enabled;
+}
+
 void PdfDocument::load(const QString& path)
 {
+    d->cancelLoading();
+    d->resetPageSizes(0);
+    d->resetLinks(0);
+    d->renderCosts.reset();
+
     d->doc.load(path);
+    d->resetFingerprint(path);
+    d->resetPageSizes(d->doc.pageCount());
+    d->resetLinks(d->doc.pageCount());
+
+    for (int page = 0; page < d->doc.pageCount(); ++page)
+        d->publishPageSize(page);
+
+    d->startLinkPass(d->doc.pageCount());
+}
+
+auto PdfDocument::loadAsync(const QString& path) -> QFuture<int>
+{
+    d->cancelLoading();
+    d->resetPageSizes(0);
+    d->resetLinks(0);
+    d->renderCosts.reset();
+    d->resetFingerprint(path);
+
+    // NOTE: the worker is waited for by the destructor and by the next load, so it may use the document freely
+    d->loading = QtConcurrent::run([this, path](QPromise<int>& promise)
+    {
+        QElapsedTimer timer;
+        timer.start();
+
+        // Nothing is connected to the QPdfDocument, so loading it on a worker thread is fine even though it lives
+        // in the owner's thread: its signals are emitted here, but reach nobody
+        if (d->doc.load(path) != QPdfDocument::Error::None)
+            return;
+
+        const int count = d->doc.pageCount();
+        d->resetPageSizes(count);
+        d->resetLinks(count);
+
+        // The first page is enough to show the document
+        if (count > 0)
+        {
+            d->publishPageSize(0);
+            promise.addResult(0);
+
+            qDebug() << "First page loaded: pages =" << count << "time =" << timer.elapsed() << "ms";
+        }
+
+        for (int page = 1; page < count && !promise.isCanceled(); page += PageSizesBatch)
+        {
+            QList<int> batch;
+
+            for (int i = page; i < std::min(page + PageSizesBatch, count); ++i)
+            {
+                d->publishPageSize(i);
+                batch.append(i);
+            }
+
+            promise.addResults(batch);
+        }
+
+        qDebug() << "Document loaded: pages =" << count << "time =" << timer.elapsed() << "ms";
+
+        if (!promise.isCanceled())
+            d->startLinkPass(count);
+    });
+
+    return d->loading;
 }
 
 auto PdfDocument::pageCount() const -> std::size_t
 {
-    return d->doc.pageCount();
+    return d->pageCount.load(std::memory_order_acquire);
 }
 
 auto PdfDocument::pagePointSize(int page) const -> QSizeF
 {
-    return d->doc.pagePointSize(page);
+    const int known = d->knownSizes.load(std::memory_order_acquire);
+
+    if (page >= 0 && page < known)
+        return d->pageSizes[page];
+
+    // Not loaded yet, most documents have pages of the same size
+    return known > 0 ? d->pageSizes[0] : QSizeF();
+}
+
+auto PdfDocument::isPageSizeKnown(int page) const -> bool
+{
+    return page >= 0 && page < d->knownSizes.load(std::memory_order_acquire);
 }
 
 auto PdfDocument::text(int page, int from, int count) const -> QString
 {
-    return d->doc.getTextContentsAtIndex(page, from, from + count);
+    return d->doc.getTextContentsAtIndex(page, from, endIndex(from, count));
 }
 
 auto PdfDocument::textBoxes(int page, int from, int count) const -> QList<QRectF>
 {
-    return d->doc.getCharGeometryAtIndex(page, from, from + count);
+    return d->doc.getCharGeometryAtIndex(page, from, endIndex(from, count));
 }
 
 auto PdfDocument::render(int page, qreal scale) const -> QFuture<QImage>
 {
     return QtConcurrent::run(
-        [&document=d->doc, page, scale](QPromise<QImage>& promise)
+        [this, &document=d->doc, page, scale](QPromise<QImage>& promise)
         {
-            struct PromiseCancel : QPdfDocument::ICancel {
-                explicit PromiseCancel(QPromise<QImage>& promise) : m_promise(promise) {}
-                bool isCancelled() final
-                {
-                    return m_promise.isCanceled();
-                }
-
-            private:
-                QPromise<QImage>& m_promise;
-            };
-
-            const auto pointSize = document.pagePointSize(page);
+            const auto pointSize = pagePointSize(page);
             const auto renderSize = pointSize * scale;
             const auto size = renderSize.toSize();
 
-            const auto cancel = std::make_unique<PromiseCancel>(promise);
+            PromiseCancel cancel(promise);
 
             QElapsedTimer timer;
             timer.start();
-            const QImage result = document.render2(page, size, cancel.get());
+            const QImage result = document.render2(page, size, &cancel);
 
             if (!result.isNull())
+            {
+                d->renderCosts.record(page, size, timer.nsecsElapsed());
                 qDebug() << "Render finished: page =" << page << "scale =" << scale << " time =" << timer.elapsed() << "ms";
+            }
 
             promise.addResult(result);
         }
     );
 }
 
-auto PdfDocument::links(int page) const -> QList<DocumentLink>
+auto PdfDocument::render(int page, const DocumentRenderTarget& target) const -> QFuture<void>
 {
-    QList<DocumentLink> Links;
+    // Broken output must not be reported as rendered
+    if (!isUsable(target))
+        return makeCanceledFuture();
 
-    // TODO: get rid of QPdfLinkModel
-    {
-        QPdfLinkModel links;
-        links.setDocument(&d->doc);
-        links.setPage(page);
+    return QtConcurrent::run(
+        [&document=d->doc, &costs=d->renderCosts, page, target](QPromise<void>& promise)
+        {
+            PromiseCancel cancel(promise);
 
-        for (int i = 0; i < links.rowCount(QModelIndex()); ++i)
+            QElapsedTimer timer;
+            timer.start();
+
+            // NOTE: Qt::Pdf renders only into its own images, so the result is copied into the target once, right here;
+            // a render into the caller's buffer needs an entry point in the patched Qt::Pdf
+            const QImage result = document.render2(page, target.Size, &cancel);
+
+            if (!result.isNull())
+                costs.record(page, target.Size, timer.nsecsElapsed());
+
+            if (result.isNull() || promise.isCanceled())
+            {
+                promise.future().cancel();
+                return;
+            }
+
+            if (result.format() == target.Format)
+            {
+                const qsizetype rowSize = (qsizetype(target.Size.width()) * result.depth() + 7) / 8;
+
+                for (int y = 0; y < std::min(result.height(), target.Size.height()); ++y)
+                    std::memcpy(target.Data + y * target.BytesPerLine, result.constScanLine(y), rowSize);
+
+                return;
+            }
+
+            // Converted while being copied, without an intermediate image
+            QImage view(target.Data, target.Size.width(), target.Size.height(), target.BytesPerLine, target.Format);
+            QPainter painter(&view);
+            painter.setCompositionMode(QPainter::CompositionMode_Source);
+            painter.drawImage(0, 0, result);
+        }
+    );
+}
+
+auto PdfDocument::renderBands(int page, qreal scale, int bandHeight) const -> QFuture<QImage>
+{
+    return QtConcurrent::run(
+        [this, &document=d->doc, page, scale, bandHeight](QPromise<QImage>& promise)
         {
-            QVariant variant = links.data(links.index(i), static_cast<int>(QPdfLinkModel::Role::Link));
-            QPdfLink link = variant.value<QPdfLink>();
+            const QSize size = (pagePointSize(page) * scale).toSize();
 
-            if (link.url().isValid())
-                Links.append({ page, link.rectangles(), DocumentLink::Url(link.url())});
-            else
-                Links.append({ page, link.rectangles(), DocumentLink::Jump(link.page(), link.zoom(), link.location() )});
+            QElapsedTimer timer;
+            timer.start();
+
+            // NOTE: every render loads the page again and a clipped one can not be canceled, as only render2 takes ICancel,
+            // so there are just two of them: the top band, which comes sooner as only its pixels are rasterized, and the page
+            if (bandHeight < size.height())
+            {
+                const QRect band(0, 0, size.width(), bandHeight);
+
+                QPdfDocumentRenderOptions options;
+                options.setScaledSize(size);
+                options.setScaledClipRect(band);
+
+                if (QImage image = document.render(page, band.size(), options); !image.isNull() && !promise.isCanceled())
+                    promise.addResult(image);
+            }
+
+            PromiseCancel cancel(promise);
+
+            QElapsedTimer pageTimer;
+            pageTimer.start();
+
+            const QImage image = document.render2(page, size, &cancel);
+
+            // A page with a hole is no page, the band already reported is dropped as well
+            if (image.isNull() || promise.isCanceled())
+            {
+                promise.future().cancel();
+                return;
+            }
+
+            d->renderCosts.record(page, size, pageTimer.nsecsElapsed());
+            promise.addResult(image);
+
+            qDebug() << "Banded render finished: page =" << page << "scale =" << scale << " time =" << timer.elapsed() << "ms";
         }
-    }
+    );
+}
+
+auto PdfDocument::links(int page) const -> QList<DocumentLink>
+{
+    if (page < 0 || page >= d->pageLinks.size())
+        return {};
+
+    if (const QList<DocumentLink>* links = d->findLinks(page); links)
+        return *links;
+
+    // The background pass has not reached the page yet
+    QPdfLinkModel model;
+    model.setDocument(&d->doc);
+
+    QList<DocumentLink> links = d->extractLinks(model, page);
+    d->storeLinks(page, links);
+    return links;
+}
+
+auto PdfDocument::renderCost(int page) const -> qreal
+{
+    return d->renderCosts.cost(page);
+}
+
+auto PdfDocument::fingerprint() const -> QByteArray
+{
+    const QMutexLocker locker(&d->fingerprintMutex);
+
+    if (!d->fingerprint)
+        d->fingerprint = fileFingerprint(d->path);
 
-    return Links;
+    return *d->fingerprint;
 }
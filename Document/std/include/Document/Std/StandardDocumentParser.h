@@ -2,6 +2,7 @@
 
 #include <Document/API/DocumentParser.h>
 
+// NOTE: queries may be made from any thread, while the setters and the feedback belong to the thread that created the parser
 class StandardDocumentParser : public DocumentParser
 {
 public:
@@ -9,14 +10,35 @@ public:
     ~StandardDocumentParser() override;
 
     auto setLayoutCacheLimit(qreal bytes) const -> void;
+    auto setLayoutPrefetchRadius(int pages) const -> void;
+
+    // NOTE: layouts are persisted in the directory per document fingerprint and reused on reopen
+    auto setLayoutStorage(const QString& directory) const -> void;
 
     auto setDocument(std::shared_ptr<const Document> document) -> void final;
+    auto setFeedback(DocumentParserFeedback* feedback) -> void final;
+
+    auto isReady(int page) const -> bool final;
+    auto prefetch(int page) const -> void final;
+    auto whenReady(int page) const -> QFuture<void> final;
+
+    // NOTE: blocks until the page layout is built (by this or another thread), meant for worker threads
+    auto waitForLayout(int page) const -> bool;
+
+    // Page text kept in the cached or stored layout, nullopt if there is none yet or the document is not the parser's one;
+    // never builds the layout
+    auto layoutText(const Document& document, int page) const -> std::optional<QString>;
 
     auto textHit(int page, QPointF point, uint8_t lod) const -> bool final;
     auto textRegion() const -> std::unique_ptr<DocumentTextRegion> final;
+    auto textSelection() const -> std::unique_ptr<DocumentTextSelection> final;
+    auto textGeometry(int page, int from, int count) const -> QList<QRectF> final;
 
     auto linkHit(int page, QPointF point) const -> bool final;
     auto link(int page, QPointF point) const -> std::optional<DocumentLink> final;
+    auto link(int page, int32_t id) const -> std::optional<DocumentLink> final;
+
+    auto hitTest(int page, QPointF point, uint8_t lod) const -> DocumentHit final;
 
 private:
     struct Private;
@@ -2,19 +2,32 @@
 
 #include <Document/API/DocumentRenderer.h>
 
+class StandardRenderScheduler;
+
 class StandardDocumentRenderer : public DocumentRenderer
 {
 public:
     StandardDocumentRenderer();
     ~StandardDocumentRenderer() override;
 
-    auto setPixelRatio(qreal ratio) const -> void;
     auto setRenderCacheLimit(qreal bytes) const -> void;
+    auto setThumbnailCacheLimit(qreal bytes) const -> void;
     auto setRenderDelay(int ms) const -> void;
 
+    // NOTE: renderers sharing a scheduler share its render slots and memory limit
+    auto setScheduler(const std::shared_ptr<StandardRenderScheduler>& scheduler) const -> void;
+
     auto setDocument(std::shared_ptr<const Document> document) -> void final;
 
-    auto requestPageRender(int page, qreal scale, DocumentRenderFeedback* feedback) const -> std::optional<QImage> final;
+    auto addFeedback(DocumentRenderFeedback* feedback) -> void final;
+    auto removeFeedback(DocumentRenderFeedback* feedback) -> void final;
+
+    auto requestPageRender(int page, qreal scale, qreal pixelRatio, DocumentRenderFeedback* feedback) const -> std::optional<QImage> final;
+    auto requestThumbnail(int page) const -> std::optional<QImage> final;
+
+    // NOTE: thread-safe, concurrent requests of the same page and (device) scale share one render and get the same image,
+    // which is also cached for the views; the null image means failure
+    auto render(int page, qreal scale) const -> QFuture<QImage>;
 
 private:
     struct Private;
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <Document/API/DocumentSearch.h>
+
+class StandardDocumentParser;
+
+class StandardDocumentSearch : public DocumentSearch
+{
+public:
+    StandardDocumentSearch();
+    ~StandardDocumentSearch() override;
+
+    // NOTE: page texts are taken from the parser's layouts where they exist, so they are not extracted twice;
+    // takes effect with the next document
+    auto setParser(std::shared_ptr<const StandardDocumentParser> parser) -> void;
+
+    auto setDocument(std::shared_ptr<const Document> document) -> void final;
+
+    // NOTE: query is split into words, a hit is a sequence of whole words matching them case-insensitively;
+    // in scripts written without spaces (Han, Kana, Thai, ...) every character is a word, so any substring is found
+    auto find(const QString& query) const -> QFuture<DocumentSearchHit> final;
+
+    auto isIndexed() const -> bool;
+
+private:
+    struct Private;
+    std::unique_ptr<Private> d;
+};
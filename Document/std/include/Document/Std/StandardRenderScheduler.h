@@ -0,0 +1,27 @@
+#pragma once
+
+#include <memory>
+
+#include <QtGlobal>
+
+class RenderScheduler;
+class StandardDocumentRenderer;
+
+// Shared by the renderers of all open documents, see StandardDocumentRenderer::setScheduler
+class StandardRenderScheduler
+{
+public:
+    StandardRenderScheduler();
+    ~StandardRenderScheduler();
+
+    auto setConcurrency(int renders) const -> void;
+    auto setMemoryLimit(qreal bytes) const -> void;
+
+    // NOTE: the active renderer is served first and gives its memory up last
+    auto setActiveRenderer(const StandardDocumentRenderer* renderer) const -> void;
+
+private:
+    friend class StandardDocumentRenderer;
+
+    std::shared_ptr<RenderScheduler> d;
+};
@@ -1,300 +1,423 @@
 #include "StandardDocumentParser.h"
 
-#include <QCache>
+#include <QtConcurrent/QtConcurrentRun>
+#include <QDir>
+#include <QPromise>
+#include <QMutex>
+#include <QThread>
+#include <QThreadPool>
 #include <QRectF>
 
 #include <Document/API/Document.h>
 
+#include "layout/LayoutCache.h"
+#include "layout/LayoutStore.h"
+#include "layout/PageLayout.h"
+
 namespace
 {
-    using LineIndices = std::pair<int32_t, int32_t>;
-    using CharIndices = std::pair<int32_t, int32_t>;
+    QFuture<void> makeFinishedFuture(const bool canceled)
+    {
+        QPromise<void> promise;
+        promise.start();
 
-    using InLineRange = std::pair<qreal, qreal>;
+        if (canceled)
+            promise.future().cancel();
 
-    struct LineLayout
+        promise.finish();
+        return promise.future();
+    }
+
+    PageLayout buildPageLayout(const Document& document, const int page)
     {
-        CharIndices Indices; // [a; b)
-        QRectF Geometry;
-        QList<InLineRange> Chars;
+        return PageLayout::build(document.textBoxes(page), document.text(page), document.links(page));
+    }
+}
 
-        [[nodiscard]] QList<InLineRange>::const_iterator findFirstCharCrossedBy(const QRectF& rect) const
-        {
-            if (rect.bottom() < Geometry.top() || rect.top() > Geometry.bottom())
-                return Chars.constEnd();
+struct StandardDocumentParser::Private
+{
+    using Layout = LayoutCache::Layout;
 
-            const auto it = std::lower_bound(Chars.constBegin(), Chars.constEnd(), rect.left(),
-                [](const InLineRange& range, const qreal left) {
-                    return charCenter(range) < left;
-                });
+    struct PendingLayout
+    {
+        QFuture<Layout> Build;
+        QFuture<void> Notify;
+    };
 
-            if (it != Chars.constEnd() && charCenter(*it) <= rect.right())
-                return it;
+    ~Private()
+    {
+        cancelPendingLayouts();
+    }
 
-            return Chars.constEnd();
-        }
+    QList<QRectF> getGeometryByIndices(const int page, const LineIndices& iLine, const CharIndices& iChar) const
+    {
+        const Layout layout = getPageLayout(page);
 
-        [[nodiscard]] QList<InLineRange>::const_iterator findLastCharCrossedBy(const QRectF& rect) const
-        {
-            if (rect.bottom() < Geometry.top() || rect.top() > Geometry.bottom())
-                return Chars.constEnd();
+        if (!layout || iLine.first == -1)
+            return {};
 
-            auto it = std::upper_bound(Chars.constBegin(), Chars.constEnd(), rect.right(),
-                [](const qreal right, const InLineRange& range) {
-                    return right < charCenter(range);
-                });
+        QList<QRectF> geometry;
 
-            if (it != Chars.constBegin())
-            {
-                --it;
-                if (charCenter(*it) >= rect.left())
-                    return it;
-            }
+        const auto firstLine = iLine.first;
+        const auto lastLine = iLine.second;
+        const auto startIndex = iChar.first;
+        const auto endIndex = iChar.second;
 
-            return Chars.constEnd();
-        }
+        const QRectF firstLineGeometry = layout->lineGeometryByIndices(firstLine, startIndex, endIndex);
+        geometry.append(firstLineGeometry);
 
-        [[nodiscard]] QRectF getGeometryByIndices(int begin, int end) const
+        if (firstLine != lastLine)
         {
-            if (begin >= Indices.second || begin >= end)
-                return {};
+            for (auto line = firstLine + 1; line < lastLine; ++line)
+                geometry.append(layout->lineGeometry(line));
 
-            begin = std::max(Indices.first, begin);
-            end = std::min(Indices.second, end);
+            const QRectF lastLineGeometry = layout->lineGeometryByIndices(lastLine, startIndex, endIndex);
+            geometry.append(lastLineGeometry);
+        }
 
-            if (begin >= end)
-                return {};
+        return geometry;
+    }
 
-            const qreal left = Chars[begin - Indices.first].first;
-            const qreal right = (end == Indices.second)
-                ? Geometry.right()
-                : Chars[end - Indices.first].first;
+    QString getText(const int page, const CharIndices& iChar) const
+    {
+        const Layout layout = getPageLayout(page);
 
-            QRectF subGeometry = Geometry;
-            subGeometry.setLeft(left);
-            subGeometry.setRight(right);
+        if (!layout || iChar.first == -1)
+            return {};
 
-            return subGeometry;
-        }
+        return layout->text({ iChar.first, iChar.second + 1 }).toString();
+    }
 
-    private:
-        static qreal charCenter(const InLineRange& charRange)
-        {
-            return (charRange.first + charRange.second) / 2.0;
-        }
-    };
+    // Geometry of chars [a; b), b may exceed the page chars count
+    QList<QRectF> getRangeGeometry(const int page, CharIndices iChar) const
+    {
+        const Layout layout = getPageLayout(page);
+
+        if (!layout)
+            return {};
+
+        iChar.second = std::min(iChar.second, layout->charCount());
 
-    struct PageLayout
+        if (iChar.first >= iChar.second)
+            return {};
+
+        return getGeometryByIndices(page, { layout->lineOfChar(iChar.first), layout->lineOfChar(iChar.second - 1) }, iChar);
+    }
+
+    // Text of chars [a; b), b may exceed the page text size
+    QString getRangeText(const int page, const CharIndices& iChar) const
     {
-        QList<LineLayout> Lines;
-        QList<DocumentLink> Links;
+        if (const Layout layout = loadPageLayout(page); layout)
+            return layout->text(iChar).toString();
 
-        [[nodiscard]] QPair<QList<LineLayout>::const_iterator, QList<LineLayout>::const_iterator> findLinesCrossedBy(const QRectF& rect) const
-        {
-            auto first = std::partition_point(Lines.constBegin(), Lines.constEnd(),
-                [&rect](const LineLayout& line) {
-                    return line.Geometry.bottom() < rect.top();
-                });
-
-            auto last = std::partition_point(first, Lines.constEnd(),
-                [&rect](const LineLayout& line) {
-                    return line.Geometry.top() <= rect.bottom();
-                });
-
-            if (first == Lines.constEnd() || last == Lines.constBegin() || first >= last) {
-                return { Lines.constEnd(), Lines.constEnd() };
-            }
+        const std::shared_ptr<const Document> source = currentDocument();
 
-            --last;
+        if (!source)
+            return {};
 
-            while (first <= last && !first->Geometry.intersects(rect)) {
-                ++first;
-            }
+        // Long selections may span pages whose layouts were evicted
+        if (iChar.second == std::numeric_limits<int32_t>::max())
+            return source->text(page, iChar.first);
 
-            if (first > last) {
-                return { Lines.constEnd(), Lines.constEnd() };
-            }
+        if (iChar.first >= iChar.second)
+            return {};
 
-            while (last >= first && !last->Geometry.intersects(rect)) {
-                --last;
-            }
+        return source->text(page, iChar.first, iChar.second - iChar.first);
+    }
 
-            return { first, last };
-        }
+    std::optional<CharIndices> getUnit(const int page, const QPointF pos, const uint8_t lod) const
+    {
+        const Layout layout = getPageLayout(page);
 
-        [[nodiscard]] QList<LineLayout>::const_iterator findLineAt(const QPointF point) const
-        {
-            const auto lineIt = std::lower_bound(Lines.begin(), Lines.end(), point, [](const LineLayout& line, const QPointF& p) -> bool {
-                return line.Geometry.bottom() < p.y();
-            });
+        if (!layout)
+            return std::nullopt;
 
-            if (lineIt == Lines.end() || point.y() < lineIt->Geometry.top())
-                return Lines.end();
+        return layout->findUnitAt(pos, lod);
+    }
 
-            if (lineIt->Geometry.left() <= point.x() && point.x() <= lineIt->Geometry.right())
-                return lineIt;
+    bool hasLink(const int page, const QPointF pos) const
+    {
+        const Layout layout = getPageLayout(page);
+        return layout && layout->findLink(pos) != -1;
+    }
 
-            return Lines.end();
-        }
-    };
-}
+    std::optional<DocumentLink> getLink(const int page, const QPointF pos) const
+    {
+        const Layout layout = getPageLayout(page);
 
-struct StandardDocumentParser::Private
-{
-    QList<QRectF> getGeometryByIndices(const int page, const LineIndices& iLine, const CharIndices& iChar) const
+        if (!layout)
+            return std::nullopt;
+
+        if (const int index = layout->findLink(pos); index != -1)
+            return layout->link(page, index);
+
+        return std::nullopt;
+    }
+
+    std::optional<DocumentLink> getLink(const int page, const int32_t id) const
     {
-        const auto& [Lines, _] = getPageLayout(page);
+        const Layout layout = getPageLayout(page);
 
-        if (iLine.first == -1)
-            return {};
+        if (!layout || id < 0 || id >= layout->linkCount())
+            return std::nullopt;
 
-        QList<QRectF> geometry;
+        return layout->link(page, id);
+    }
 
-        const auto firstLineIt = Lines.begin() + iLine.first;
-        const auto lastLineIt = Lines.begin() + iLine.second;
-        const auto startIndex = iChar.first;
-        const auto endIndex = iChar.second;
+    DocumentHit getHit(const int page, const QPointF pos, const uint8_t lod) const
+    {
+        const Layout layout = getPageLayout(page);
 
-        const QRectF firstLineGeometry = firstLineIt->getGeometryByIndices(startIndex, endIndex);
-        geometry.append(firstLineGeometry);
+        if (!layout)
+            return {};
 
-        if (firstLineIt != lastLineIt)
-        {
-            for (auto lineIt = firstLineIt + 1; lineIt < lastLineIt; ++lineIt)
-                geometry.append(lineIt->Geometry);
+        DocumentHit hit;
+        hit.Link = layout->findLink(pos);
+        hit.Line = layout->findLineAt(pos);
 
-            const QRectF lastLineGeometry = lastLineIt->getGeometryByIndices(startIndex, endIndex);
-            geometry.append(lastLineGeometry);
-        }
+        if (hit.Link != -1)
+            hit.Type = DocumentHit::Kind::Link;
+        else if (layout->hitTest(pos, lod))
+            hit.Type = DocumentHit::Kind::Text;
 
-        return geometry;
+        return hit;
     }
 
-    QString getText(const int page, const CharIndices& iChar) const
+    // Blocks until the layout is built, nullptr if the page does not exist
+    auto waitPageLayout(const int page) const -> Layout
     {
-        const auto startIndex = iChar.first;
-        const auto endIndex = iChar.second;
-        return document->text(page, startIndex, endIndex - startIndex + 1);
+        if (Layout layout = loadPageLayout(page); layout)
+            return layout;
+
+        QFuture<Layout> future = requestPageLayout(page);
+
+        // Either no such page or the layout has just been built
+        if (!future.isValid())
+            return loadPageLayout(page);
+
+        future.waitForFinished();
+        return future.isCanceled() ? nullptr : future.result();
     }
 
-    std::optional<DocumentLink> getLink(const int page, const QPointF pos) const
+    QFuture<void> whenPageReady(const int page) const
     {
-        const auto& layout = getPageLayout(page);
+        if (loadPageLayout(page))
+            return makeFinishedFuture(false);
 
-        for (const auto& link : layout.Links)
-        {
-            for (const auto& rect : link.geometry())
-                if (rect.contains(pos))
-                    return link;
-        }
+        QFuture<Layout> future = requestPageLayout(page);
 
-        return std::nullopt;
+        if (!future.isValid())
+            return makeFinishedFuture(!loadPageLayout(page));
+
+        return future.then(QtFuture::Launch::Sync, [](const Layout&) {});
     }
 
 private:
-    auto getPageLayout(const int page) const -> const PageLayout&
+    // Returns nullptr and schedules the layout building when it is not ready yet
+    auto getPageLayout(const int page) const -> Layout
     {
-        PageLayout* layout = pageLayoutCache.object(page);
+        if (Layout layout = loadPageLayout(page); layout)
+            return layout;
 
-        if (!layout)
+        (void) requestPageLayout(page);
+        return nullptr;
+    }
+
+    // Returns the cached layout or the one stored by a previous session, nullptr if there is none
+    auto loadPageLayout(const int page) const -> Layout
+    {
+        if (Layout layout = pageLayoutCache.find(page); layout)
+            return layout;
+
+        // NOTE: the generation is taken before the store, which setDocument resets before starting a new generation
+        const int generation = pageLayoutCache.generation();
+        const std::shared_ptr<LayoutStore> store = layoutStore();
+
+        if (std::optional<PageLayout> stored = store ? store->load(page) : std::nullopt; stored)
+            return pageLayoutCache.insert(page, std::move(*stored), generation);
+
+        return nullptr;
+    }
+
+    // Written on the owner thread under the pending layouts lock, which other threads take to read it
+    [[nodiscard]] std::shared_ptr<const Document> currentDocument() const
+    {
+        const QMutexLocker locker(&pendingMutex);
+        return document;
+    }
+
+    // NOTE: the store is thread-safe itself, the slot is locked only to take it
+    [[nodiscard]] std::shared_ptr<LayoutStore> layoutStore() const
+    {
+        const QMutexLocker locker(&layoutStoreSlot->Mutex);
+        return layoutStoreSlot->Store;
+    }
+
+    // The fingerprint might take a read of the whole file, so the store is opened in the background;
+    // layouts built until then are just not stored
+    void openLayoutStore()
+    {
+        const int generation = closeLayoutStore();
+
+        if (!document || layoutStorage.isEmpty())
+            return;
+
+        QThreadPool::globalInstance()->start([slot = layoutStoreSlot, generation, document = document, directory = layoutStorage]
         {
-            layout = new PageLayout();
+            const QByteArray fingerprint = document->fingerprint();
+
+            if (fingerprint.isEmpty() || !QDir().mkpath(directory))
+                return;
+
+            const QString path = QDir(directory).filePath(LayoutStore::fileName(fingerprint));
+            auto store = std::make_shared<LayoutStore>();
 
-            // Line forming method
+            if (!store->open(path, static_cast<int>(document->pageCount())))
             {
-                QList<QRectF> charBoxes = document->textBoxes(page);
-                QList<LineLayout> lines;
+                qWarning() << "Layout storage is not available:" << path;
+                return;
+            }
 
-                // TODO: change line detection method because right now it sometimes is wrong
-                const auto isOnLine = [](const QRectF& charRect, const QRectF& lineRect) -> bool
-                {
-                    return charRect.top() <= lineRect.bottom() && charRect.bottom() >= lineRect.top();
-                };
+            // Another document or directory might have been set meanwhile
+            const QMutexLocker locker(&slot->Mutex);
 
-                LineLayout currentLine = {};
-                int startIndex = 0;
+            if (slot->Generation == generation)
+                slot->Store = std::move(store);
+        });
+    }
 
-                for (int i = 0; i < charBoxes.size(); ++i)
-                {
-                    const auto& box = charBoxes[i];
-
-                    if (currentLine.Chars.isEmpty())
-                    {
-                        currentLine.Geometry = box;
-                        currentLine.Chars.emplaceBack(box.left(), box.right());
-                        startIndex = i;
-                    }
-                    else
-                    {
-                        if (isOnLine(currentLine.Geometry, box))
-                        {
-                            currentLine.Geometry |= box; // TODO: optimize calculations
-                            currentLine.Chars.emplaceBack(box.left(), box.right());
-                        }
-                        else
-                        {
-                            currentLine.Indices = qMakePair(startIndex, i);
-                            lines.append(currentLine);
-
-                            currentLine = {};
-
-                            currentLine.Geometry = box;
-                            currentLine.Chars.emplaceBack(box.left(), box.right());
-                            startIndex = i;
-                        }
-                    }
-                }
+    // Returns the generation the store has been reset in
+    int closeLayoutStore()
+    {
+        const QMutexLocker locker(&layoutStoreSlot->Mutex);
+        layoutStoreSlot->Store.reset();
+        return ++layoutStoreSlot->Generation;
+    }
 
-                if (!currentLine.Chars.isEmpty())
-                {
-                    currentLine.Indices = qMakePair(startIndex, charBoxes.size());
-                    lines.append(currentLine);
-                }
+    // Single flight: a page layout is built once however many threads ask for it,
+    // the invalid future means there is nothing to wait for
+    QFuture<Layout> requestPageLayout(const int page) const
+    {
+        // Stored layouts are looked up before taking the lock, so requesters do not wait for each other's reads
+        if (loadPageLayout(page))
+            return {};
 
-                layout->Lines = lines;
+        const QMutexLocker locker(&pendingMutex);
+
+        if (!document || page < 0 || page >= static_cast<int>(document->pageCount()))
+            return {};
+
+        if (const auto it = pendingLayouts.constFind(page); it != pendingLayouts.cend())
+            return it->Build;
+
+        // It might have been built while the lock was being taken
+        if (pageLayoutCache.contains(page))
+            return {};
+
+        const int generation = pageLayoutCache.generation();
+
+        QFuture<Layout> build = QtConcurrent::run([this, document = document, generation, page]() -> Layout
+        {
+            PageLayout layout = buildPageLayout(*document, page);
+
+            qDebug() << "Layout" << page << "lines =" << layout.lineCount() << "links =" << layout.linkCount() << "size =" << layout.sizeInBytes() << "B";
+
+            // The store of a document set meanwhile is opened in a later generation
+            if (const std::shared_ptr<LayoutStore> store = layoutStore(); store && generation == pageLayoutCache.generation())
+                store->store(page, layout);
+
+            return pageLayoutCache.insert(page, std::move(layout), generation);
+        });
+
+        // Feedback is delivered on the owner thread, whichever thread has asked for the layout
+        QFuture<void> notify = build.then(owner, [this, generation, page](const Layout&)
+        {
+            if (generation != pageLayoutCache.generation())
+                return;
+
+            {
+                const QMutexLocker locker(&pendingMutex);
+                pendingLayouts.remove(page);
             }
 
-            layout->Links = document->links(page);
+            if (feedback)
+                feedback->layoutReady(page);
+        });
+
+        pendingLayouts.insert(page, { build, notify });
+        return build;
+    }
+
+    void prefetchPageLayouts(const int page) const
+    {
+        (void) requestPageLayout(page);
 
-            (void) pageLayoutCache.insert(page, layout); // TODO: make it work calculating layout size after creation
+        for (int distance = 1; distance <= prefetchRadius; ++distance)
+        {
+            (void) requestPageLayout(page + distance);
+            (void) requestPageLayout(page - distance);
+        }
+    }
 
-            qDebug() << "Layout" << page;
-            for (const auto& line : layout->Lines)
-                qDebug() << "    " << line.Indices << line.Geometry << line.Geometry.top();
+    // NOTE: running builds are waited for, they use the cache; the layouts they still bring are not cached
+    void cancelPendingLayouts()
+    {
+        QHash<int, PendingLayout> pending;
 
-            for (const auto& link : layout->Links)
-                qDebug().noquote() << "    " << link.toString();
+        {
+            const QMutexLocker locker(&pendingMutex);
+            pending.swap(pendingLayouts);
         }
 
-        return *layout;
+        waitPendingLayouts(pending);
+    }
+
+    static void waitPendingLayouts(QHash<int, PendingLayout>& pending)
+    {
+        for (PendingLayout& layout : pending)
+            layout.Notify.cancelChain();
+
+        for (PendingLayout& layout : pending)
+            layout.Build.waitForFinished();
     }
 
-    auto getIndices(const int page, const QRectF& rect) const -> std::pair<LineIndices, CharIndices>
+    auto getIndices(const int page, const QRectF& rect, const uint8_t lod) const -> std::pair<LineIndices, CharIndices>
     {
-        const PageLayout& layout = getPageLayout(page);
-        const auto [firstLineIt, lastLineIt] = layout.findLinesCrossedBy(rect.normalized());
+        const Layout layout = getPageLayout(page);
 
-        if (firstLineIt == layout.Lines.end())
+        if (!layout)
         {
             return {{ -1, -1 }, { -1, -1 }};
         }
 
-        return {
-            {
-                std::distance(layout.Lines.begin(), firstLineIt),
-                std::distance(layout.Lines.begin(), lastLineIt),
-            },
-            {
-                firstLineIt->Indices.first + std::distance(firstLineIt->Chars.begin(), firstLineIt->findFirstCharCrossedBy(rect)),
-                lastLineIt->Indices.first + std::distance(lastLineIt->Chars.begin(), lastLineIt->findLastCharCrossedBy(rect)) + 1,
-            }
-        };
+        return layout->findRegion(rect, lod);
     }
 
     friend class StandardDocumentParser;
 
     std::shared_ptr<const Document> document;
-    mutable QCache<int, PageLayout> pageLayoutCache;
+    DocumentParserFeedback* feedback = nullptr;
+
+    int prefetchRadius = 1;
+
+    QString layoutStorage;
+
+    // Shared with the worker opening the store, which might outlive the parser
+    struct LayoutStoreSlot
+    {
+        QMutex Mutex;
+        std::shared_ptr<LayoutStore> Store;
+        int Generation = 0;
+    };
+
+    const std::shared_ptr<LayoutStoreSlot> layoutStoreSlot = std::make_shared<LayoutStoreSlot>();
+
+    mutable LayoutCache pageLayoutCache;
+
+    QThread* const owner = QThread::currentThread();
+
+    mutable QHash<int, PendingLayout> pendingLayouts;
+    mutable QMutex pendingMutex; // also guards the document and the start of a cache generation
 };
 
 StandardDocumentParser::StandardDocumentParser()
@@ -307,22 +430,79 @@ StandardDocumentParser::~StandardDocumentParser() = default;
 
 auto StandardDocumentParser::setLayoutCacheLimit(qreal bytes) const -> void
 {
-    d->pageLayoutCache.setMaxCost(bytes);
+    d->pageLayoutCache.setMaxCost(static_cast<qsizetype>(bytes));
+}
+
+auto StandardDocumentParser::setLayoutPrefetchRadius(int pages) const -> void
+{
+    d->prefetchRadius = std::max(0, pages);
+}
+
+auto StandardDocumentParser::setLayoutStorage(const QString& directory) const -> void
+{
+    d->layoutStorage = directory;
+    d->openLayoutStore();
 }
 
 auto StandardDocumentParser::setDocument(std::shared_ptr<const Document> document) -> void
 {
-    // Reset active state
-    d->pageLayoutCache.clear();
+    // The old store goes first: a reader of the new generation never takes it
+    (void) d->closeLayoutStore();
+
+    // Requests of other threads see either the old document and generation or the new ones
+    QHash<int, Private::PendingLayout> pending;
+
+    {
+        const QMutexLocker locker(&d->pendingMutex);
+        d->document = std::move(document);
+        d->pageLayoutCache.clear();
+        pending.swap(d->pendingLayouts);
+    }
+
+    Private::waitPendingLayouts(pending);
+    d->openLayoutStore();
+}
+
+auto StandardDocumentParser::setFeedback(DocumentParserFeedback* feedback) -> void
+{
+    d->feedback = feedback;
+}
+
+auto StandardDocumentParser::isReady(int page) const -> bool
+{
+    return d->loadPageLayout(page) != nullptr;
+}
+
+auto StandardDocumentParser::prefetch(int page) const -> void
+{
+    d->prefetchPageLayouts(page);
+}
 
-    d->document = document;
+auto StandardDocumentParser::whenReady(int page) const -> QFuture<void>
+{
+    return d->whenPageReady(page);
+}
+
+auto StandardDocumentParser::waitForLayout(int page) const -> bool
+{
+    return d->waitPageLayout(page) != nullptr;
+}
+
+auto StandardDocumentParser::layoutText(const Document& document, int page) const -> std::optional<QString>
+{
+    if (d->currentDocument().get() != &document)
+        return std::nullopt;
+
+    if (const auto layout = d->loadPageLayout(page); layout)
+        return layout->text({ 0, std::numeric_limits<int32_t>::max() }).toString();
+
+    return std::nullopt;
 }
 
 auto StandardDocumentParser::textHit(int page, QPointF point, uint8_t lod) const -> bool
 {
-    (void) lod; // TODO: hit test for different LoD
     const auto layout = d->getPageLayout(page);
-    return layout.findLineAt(point) != layout.Lines.end();
+    return layout && layout->hitTest(point, lod);
 }
 
 auto StandardDocumentParser::textRegion() const -> std::unique_ptr<DocumentTextRegion>
@@ -335,14 +515,14 @@ auto StandardDocumentParser::textRegion() const -> std::unique_ptr<DocumentTextR
 
         auto configure(const int page, const QRectF region, const uint8_t lod) -> void final
         {
-            (void) lod;
             m_page = page;
-            std::tie(m_iLine, m_iChar) = d_ptr->getIndices(page, region);
+            m_lod = lod;
+            std::tie(m_iLine, m_iChar) = d_ptr->getIndices(page, region, lod);
         }
 
         auto lod() const -> uint8_t final
         {
-            return 0; // TODO: different Level-of-details support
+            return m_lod;
         }
 
         auto id() const -> uint64_t final
@@ -362,6 +542,7 @@ auto StandardDocumentParser::textRegion() const -> std::unique_ptr<DocumentTextR
 
     private:
         int m_page = -1;
+        uint8_t m_lod = DocumentTextLoD::Char;
         std::pair<int32_t, int32_t> m_iLine;
         std::pair<int32_t, int32_t> m_iChar;
         Private* const d_ptr;
@@ -370,10 +551,201 @@ auto StandardDocumentParser::textRegion() const -> std::unique_ptr<DocumentTextR
     return std::make_unique<TextRegion>(d.get());
 }
 
+auto StandardDocumentParser::textSelection() const -> std::unique_ptr<DocumentTextSelection>
+{
+    struct TextSelection : DocumentTextSelection
+    {
+        explicit TextSelection(Private* const d)
+            : d_ptr(d)
+        {}
+
+        auto setAnchor(const int page, const QPointF point, const uint8_t lod) -> DocumentDirtyRegion final
+        {
+            m_anchor = { page, point };
+            m_anchorUnit.reset();
+            m_cursor = m_anchor;
+            m_lod = lod;
+            return resolve();
+        }
+
+        auto moveCursor(const int page, const QPointF point) -> DocumentDirtyRegion final
+        {
+            if (!m_anchor)
+                return {};
+
+            m_cursor = { page, point };
+            return resolve();
+        }
+
+        auto clear() -> DocumentDirtyRegion final
+        {
+            m_anchor.reset();
+            m_anchorUnit.reset();
+            m_cursor.reset();
+            return resolve();
+        }
+
+        auto refresh() -> DocumentDirtyRegion final
+        {
+            return resolve();
+        }
+
+        auto isEmpty() const -> bool final
+        {
+            return isEmpty(m_range);
+        }
+
+        auto text() const -> QString final
+        {
+            QString text;
+
+            for (int page = m_range.first.Page; !isEmpty() && page <= m_range.second.Page; ++page)
+                text += d_ptr->getRangeText(page, pageChars(m_range, page));
+
+            return text;
+        }
+
+        auto geometry(const int page) const -> QList<QRectF> final
+        {
+            if (const auto it = m_geometry.constFind(page); it != m_geometry.cend())
+                return *it;
+
+            if (!d_ptr->loadPageLayout(page))
+                return {};
+
+            const QList<QRectF> geometry = d_ptr->getRangeGeometry(page, pageChars(m_range, page));
+            m_geometry.insert(page, geometry);
+            return geometry;
+        }
+
+    private:
+        struct Point
+        {
+            int Page;
+            QPointF Pos;
+        };
+
+        struct Position
+        {
+            int Page = 0;
+            int32_t Index = 0;
+
+            auto operator<=>(const Position&) const = default;
+        };
+
+        using Range = std::pair<Position, Position>; // [a; b)
+
+        static bool isEmpty(const Range& range)
+        {
+            return range.first >= range.second;
+        }
+
+        static CharIndices pageChars(const Range& range, const int page)
+        {
+            if (isEmpty(range) || page < range.first.Page || page > range.second.Page)
+                return { 0, 0 };
+
+            return {
+                page == range.first.Page ? range.first.Index : 0,
+                page == range.second.Page ? range.second.Index : std::numeric_limits<int32_t>::max(),
+            };
+        }
+
+        DocumentDirtyRegion resolve()
+        {
+            Range range;
+
+            if (m_anchor && m_cursor)
+            {
+                // The anchor's unit does not change, it is looked up until its page layout is ready
+                if (!m_anchorUnit)
+                    m_anchorUnit = d_ptr->getUnit(m_anchor->Page, m_anchor->Pos, m_lod);
+
+                const auto& anchor = m_anchorUnit;
+                const auto cursor = d_ptr->getUnit(m_cursor->Page, m_cursor->Pos, m_lod);
+
+                // Keep the current selection until the cursor's page layout is ready
+                if (anchor && !cursor)
+                    return {};
+
+                if (anchor && cursor)
+                {
+                    const Position anchorBegin { m_anchor->Page, anchor->first };
+                    const Position anchorEnd { m_anchor->Page, anchor->second };
+                    const Position cursorBegin { m_cursor->Page, cursor->first };
+                    const Position cursorEnd { m_cursor->Page, cursor->second };
+
+                    range = cursorBegin >= anchorBegin
+                        ? Range { anchorBegin, cursorEnd }
+                        : Range { cursorBegin, anchorEnd };
+                }
+            }
+
+            // Only the symmetric difference of the previous and the new selections is changed
+            DocumentDirtyRegion dirty;
+
+            if (isEmpty(m_range) || isEmpty(range))
+            {
+                invalidate(m_range, dirty);
+                invalidate(range, dirty);
+            }
+            else
+            {
+                invalidate(std::minmax(m_range.first, range.first), dirty);
+                invalidate(std::minmax(m_range.second, range.second), dirty);
+            }
+
+            m_range = range;
+            return dirty;
+        }
+
+        void invalidate(const Range& range, DocumentDirtyRegion& dirty) const
+        {
+            for (int page = range.first.Page; !isEmpty(range) && page <= range.second.Page; ++page)
+            {
+                m_geometry.remove(page);
+
+                const CharIndices chars = pageChars(range, page);
+
+                // Whole page is changed or its geometry is not known (anymore)
+                if ((chars.first == 0 && chars.second == std::numeric_limits<int32_t>::max()) || !d_ptr->pageLayoutCache.contains(page))
+                {
+                    dirty.append({ page, QRectF() });
+                    continue;
+                }
+
+                QRectF bounds;
+
+                for (const QRectF& rect : d_ptr->getRangeGeometry(page, chars))
+                    bounds |= rect;
+
+                if (!bounds.isNull())
+                    dirty.append({ page, bounds });
+            }
+        }
+
+        std::optional<Point> m_anchor;
+        std::optional<CharIndices> m_anchorUnit;
+        std::optional<Point> m_cursor;
+        uint8_t m_lod = DocumentTextLoD::Char;
+
+        Range m_range;
+        mutable QHash<int, QList<QRectF>> m_geometry;
+
+        Private* const d_ptr;
+    };
+
+    return std::make_unique<TextSelection>(d.get());
+}
+
+auto StandardDocumentParser::textGeometry(int page, int from, int count) const -> QList<QRectF>
+{
+    return d->getRangeGeometry(page, { from, from + count });
+}
+
 auto StandardDocumentParser::linkHit(int page, QPointF point) const -> bool
 {
-    // TODO: possible optimization
-    return d->getLink(page, point).has_value();
+    return d->hasLink(page, point);
 }
 
 auto StandardDocumentParser::link(int page, QPointF point) const -> std::optional<DocumentLink>
@@ -381,3 +753,13 @@ auto StandardDocumentParser::link(int page, QPointF point) const -> std::optiona
     return d->getLink(page, point);
 }
 
+auto StandardDocumentParser::link(int page, int32_t id) const -> std::optional<DocumentLink>
+{
+    return d->getLink(page, id);
+}
+
+auto StandardDocumentParser::hitTest(int page, QPointF point, uint8_t lod) const -> DocumentHit
+{
+    return d->getHit(page, point, lod);
+}
+
@@ -2,10 +2,22 @@
 
 #include <QtConcurrent/QtConcurrentRun>
 #include <QTimer>
+#include <QMutex>
+#include <QPromise>
+#include <QFutureWatcher>
+#include <QSet>
+#include <QPainter>
+#include <QRegion>
+
+#include <cmath>
+#include <limits>
 
 #include <Document/API/Document.h>
 
+#include "StandardRenderScheduler.h"
+
 #include "custom/QCacheExt.h"
+#include "scheduler/RenderScheduler.h"
 
 namespace
 {
@@ -21,6 +33,7 @@ namespace
         return (it == set.end() || value - *prev_it <= *it - value) ? prev_it : it;
     }
 
+    // NOTE: safe to use from any thread, images are returned by value (implicitly shared) as they might be evicted any moment
     class RenderCache
     {
     public:
@@ -32,24 +45,36 @@ namespace
             });
         }
 
-        QImage* object(int page, qreal scale) const
+        std::optional<QImage> object(int page, qreal scale) const
         {
-            return _storage.object({ page, scale });
+            const QMutexLocker locker(&_mutex);
+
+            if (const QImage* image = _storage.object({ page, scale }); image)
+                return *image;
+
+            return std::nullopt;
         }
 
-        QImage* nearestObject(int page, const qreal targetScale) const
+        std::optional<QImage> nearestObject(int page, const qreal targetScale) const
         {
+            const QMutexLocker locker(&_mutex);
+
             const auto& scales = _keySets[page];
             const auto closestScaleIt = closest_element(scales, targetScale);
 
             if (closestScaleIt == scales.end())
-                return nullptr;
+                return std::nullopt;
 
-            return _storage.object({ page, *closestScaleIt });
+            if (const QImage* image = _storage.object({ page, *closestScaleIt }); image)
+                return *image;
+
+            return std::nullopt;
         }
 
         bool insert(int page, qreal scale, QImage* image) const
         {
+            const QMutexLocker locker(&_mutex);
+
             if (const bool inserted = _storage.insert({ page, scale }, image, image->sizeInBytes()); Q_LIKELY(inserted))
             {
                 _keySets[page].insert(scale);
@@ -60,30 +85,168 @@ namespace
 
         void setLimit(std::size_t bytes) const
         {
+            const QMutexLocker locker(&_mutex);
             _storage.setMaxCost(bytes);
         }
 
+        qsizetype cost() const
+        {
+            const QMutexLocker locker(&_mutex);
+            return _storage.totalCost();
+        }
+
+        // Drops the least recently used images until the cache fits the bytes
+        void trim(qsizetype bytes) const
+        {
+            const QMutexLocker locker(&_mutex);
+            _storage.shrink(bytes);
+        }
+
         void clear()
         {
+            const QMutexLocker locker(&_mutex);
             _storage.clear();
             _keySets.clear();
         }
 
     private:
+        mutable QMutex _mutex;
         mutable QCacheExt<std::pair<int, qreal>, QImage> _storage;
         mutable QHash<int, std::set<qreal>> _keySets;
     };
 
+    // One tiny image per page, sized so that all of them fit the budget
+    class ThumbnailStore
+    {
+    public:
+        void reset(const Document* document, const std::size_t budget)
+        {
+            _images.clear();
+            _states.clear();
+            _pixelsPerPage = 0.0;
+            _missing = 0;
+
+            if (!document || document->pageCount() == 0)
+                return;
+
+            const qreal bytesPerPage = static_cast<qreal>(budget) / static_cast<qreal>(document->pageCount());
+
+            // A budget that does not fit a pixel per page means no thumbnails at all
+            if (bytesPerPage < 2 /*RGB16*/)
+                return;
+
+            _pixelsPerPage = bytesPerPage / 2 /*RGB16*/;
+            _images.resize(static_cast<qsizetype>(document->pageCount()));
+            _states = QList<State>(_images.size(), State::Missing);
+            _missing = _images.size();
+        }
+
+        const QImage* object(const int page) const
+        {
+            if (page < 0 || page >= _images.size() || _states[page] != State::Ready)
+                return nullptr;
+
+            return &_images[page];
+        }
+
+        // NOTE: the null image means the page has failed, it is not tried again
+        void insert(const int page, QImage image)
+        {
+            if (page < 0 || page >= _images.size())
+                return;
+
+            if (_states[page] == State::Missing)
+                --_missing;
+
+            _states[page] = image.isNull() ? State::Failed : State::Ready;
+            _images[page] = std::move(image);
+        }
+
+        // Pages too small to get a single pixel have no thumbnails
+        void skip(const int page)
+        {
+            insert(page, QImage());
+        }
+
+        bool isComplete() const
+        {
+            return _missing == 0;
+        }
+
+        // Missing thumbnail nearest to the page that can be rendered yet, -1 if there is none
+        template<typename Predicate>
+        int nextMissing(const int page, const Predicate& isRenderable) const
+        {
+            const auto count = static_cast<int>(_images.size());
+
+            for (int distance = 0; distance < count; ++distance)
+            {
+                if (const int next = page + distance; next < count && _states[next] == State::Missing && isRenderable(next))
+                    return next;
+
+                if (const int prev = page - distance; prev >= 0 && _states[prev] == State::Missing && isRenderable(prev))
+                    return prev;
+            }
+
+            return -1;
+        }
+
+        // Every page gets the same share of the budget, whatever its size is, so mixed-size documents fit it too
+        qreal scale(const QSizeF& pointSize) const
+        {
+            const qreal pageArea = pointSize.width() * pointSize.height();
+
+            if (pageArea <= 0.0)
+                return 0.0;
+
+            return std::min(std::sqrt(_pixelsPerPage / pageArea), MaxScale);
+        }
+
+    private:
+        static constexpr qreal MaxScale = 0.25;
+
+        enum class State : uint8_t { Missing, Ready, Failed };
+
+        QList<QImage> _images;
+        QList<State> _states;
+        qsizetype _missing = 0;
+        qreal _pixelsPerPage = 0.0;
+    };
+
+    // A request shared by all the views that asked for the same image
     struct RenderRequest
     {
         int Page;
-        qreal Scale;
-        DocumentRenderFeedback* Feedback {};
+        qreal Scale; // device scale
+        QList<DocumentRenderFeedback*> Feedbacks;
+        bool Preview = false; // coarse image shown until the requested one is rendered
 
         bool operator==(const RenderRequest& other) const
         {
             return Page == other.Page && qFuzzyCompare(Scale, other.Scale);
         }
+
+        bool isOwnedBy(const DocumentRenderFeedback* feedback) const
+        {
+            return Feedbacks.size() == 1 && Feedbacks.front() == feedback;
+        }
+
+        void addFeedback(DocumentRenderFeedback* feedback)
+        {
+            if (!Feedbacks.contains(feedback))
+                Feedbacks.append(feedback);
+        }
+
+        bool isActual() const
+        {
+            return std::ranges::any_of(Feedbacks, [this](const DocumentRenderFeedback* feedback) { return feedback->isActual(Page); });
+        }
+
+        void imageReady() const
+        {
+            for (const DocumentRenderFeedback* feedback : Feedbacks)
+                feedback->imageReady(Page);
+        }
     };
 
     struct RenderState
@@ -91,6 +254,14 @@ namespace
         RenderRequest Request;
         QFuture<void> Future;
 
+        // Banded render of a large page: the image is composed as bands arrive
+        QImage Canvas;
+        std::unique_ptr<QFutureWatcher<QImage>> Bands;
+        QSet<int> DrawnBands;
+
+        // The render is shared with other threads, see releaseSharedRender
+        bool IsShared = false;
+
         RenderState(const RenderRequest& parameters, QFuture<void> future)
             : Request(parameters)
             , Future(std::move(future))
@@ -98,12 +269,15 @@ namespace
 
         ~RenderState()
         {
-            Future.cancelChain();
+            if (IsShared)
+                Future.cancel();
+            else
+                Future.cancelChain();
         }
     };
 }
 
-struct StandardDocumentRenderer::Private
+struct StandardDocumentRenderer::Private : RenderSchedulerClient
 {
     explicit Private()
     {
@@ -112,41 +286,128 @@ struct StandardDocumentRenderer::Private
         QObject::connect(&dequeueDelayTimer, &QTimer::timeout, [this]{ tryDequeueRenderRequest(); });
     }
 
-    std::optional<QImage> request(const int page, const qreal scale, DocumentRenderFeedback* feedback)
+    ~Private() override
+    {
+        waitSharedRenders();
+        thumbnailFuture.cancelChain();
+
+        if (scheduler)
+            scheduler->detach(this);
+    }
+
+    void setScheduler(const StandardDocumentRenderer* owner, std::shared_ptr<RenderScheduler> other)
+    {
+        cancelRender();
+        cancelThumbnail();
+
+        if (scheduler)
+            scheduler->detach(this);
+
+        scheduler = std::move(other);
+
+        if (scheduler)
+            scheduler->attach(owner, this);
+
+        tryDequeueRenderRequestDelayed();
+    }
+
+    // Renders only one image at a time, either a requested one or a thumbnail while there are no requests
+    bool hasWork() const override
     {
-        if (const QImage* image = renderCache.object(page, scale); image)
+        return document && !renderState && !thumbnailRunning && (!requests.empty() || !thumbnails.isComplete());
+    }
+
+    bool hasUrgentWork() const override
+    {
+        return renderState || !requests.empty();
+    }
+
+    bool startWork() override
+    {
+        if (!hasWork())
+            return false;
+
+        return requests.empty() ? startThumbnail() : startRender();
+    }
+
+    qsizetype cacheCost() const override
+    {
+        return renderCache.cost();
+    }
+
+    void trimCache(const qsizetype bytes) override
+    {
+        renderCache.trim(bytes);
+    }
+
+    // Images are keyed by device scale (scale * pixel ratio), so an image rendered for one screen
+    // is reused as is or as an interim image on another one
+    std::optional<QImage> request(const int page, const qreal scale, const qreal pixelRatio, DocumentRenderFeedback* feedback)
+    {
+        const qreal deviceScale = quantizeScale(scale * pixelRatio);
+
+        // An image rendered for a placeholder size would be stretched and cached as the page's one,
+        // the view asks again once it gets the actual size
+        if (!document || !document->isPageSizeKnown(page))
+            return std::nullopt;
+
+        if (std::optional<QImage> image = renderCache.object(page, deviceScale); image)
         {
-            qDebug() << "Cache hit: page =" << page << "scale =" << scale;
-            return *image;
+            qDebug() << "Cache hit: page =" << page << "scale =" << scale << "ratio =" << pixelRatio;
+            return image;
         }
 
-        RenderRequest request { page, scale, feedback };
-        const std::optional<QImage> nearestImage = findNearestImage(page, scale);
+        RenderRequest request { page, deviceScale, { feedback } };
+        const std::optional<QImage> nearestImage = findNearestImage(page, deviceScale);
 
-        // Check active render request for duplication
+        lastRequestedPage = page;
+
+        // Check active render request for duplication, the same image might be needed by another view
         if (renderState)
         {
             if (renderState->Request == request)
             {
-                return *nearestImage;
+                renderState->Request.addFeedback(feedback);
+
+                if (!renderState->Canvas.isNull())
+                    return renderState->Canvas;
+
+                return nearestImage;
             }
 
-            if (renderState->Request.Page == request.Page)
+            // The view has changed its scale, the image it has been waiting for is outdated
+            if (renderState->Request.Page == request.Page && !renderState->Request.Preview && renderState->Request.isOwnedBy(feedback))
             {
-                renderState.reset();
+                cancelRender();
             }
         }
 
         // Check pending render requests for duplication
         for (RenderRequest& other : requests)
         {
-            if (other.Page == request.Page)
+            if (other == request)
+            {
+                other.addFeedback(feedback);
+                return nearestImage;
+            }
+
+            if (other.Page == request.Page && !other.Preview && other.isOwnedBy(feedback))
             {
                 other.Scale = request.Scale;
-                return *nearestImage;
+                return nearestImage;
             }
         }
 
+        // The view's earlier preview of the page has been for another scale, a new one is chosen below if needed
+        std::erase_if(requests, [&request, feedback](const RenderRequest& other)
+        {
+            return other.Page == request.Page && other.Preview && other.isOwnedBy(feedback);
+        });
+
+        // Expensive pages get a coarse image first, the requested one follows
+        if (const std::optional<qreal> previewScale = findPreviewScale(page, deviceScale, nearestImage); previewScale)
+            enqueueRenderRequest({ page, quantizeScale(*previewScale), { feedback }, true });
+
         // Enqueue new request
         enqueueRenderRequest(std::move(request));
 
@@ -157,15 +418,319 @@ struct StandardDocumentRenderer::Private
         return nearestImage;
     }
 
-private:
-    std::optional<QImage> findNearestImage(const int page, const qreal scale) const
+    // Callable from any thread: identical renders share one future, which is not to be canceled,
+    // and the images go to the same cache the views use
+    QFuture<QImage> render(const int page, const qreal scale)
+    {
+        return shareRender(page, quantizeScale(scale), true);
+    }
+
+    // Renders of the views and of other threads go through the same table, so a page is rasterized once
+    // whoever asks for it. A render of the views is canceled with releaseSharedRender, unless a pinned caller,
+    // who can not cancel it, has joined it.
+    QFuture<QImage> shareRender(const int page, const qreal scale, const bool isPinned)
+    {
+        if (std::optional<QImage> image = renderCache.object(page, scale); image)
+            return makeFinishedFuture(*image);
+
+        // The document is replaced under the same lock, so the render uses the one it has been checked against
+        std::shared_ptr<const Document> source;
+        SharedRenderKey key;
+        std::shared_ptr<QPromise<QImage>> promise;
+
+        {
+            const QMutexLocker locker(&sharedRendersMutex);
+
+            source = document;
+
+            if (!source || !source->isPageSizeKnown(page))
+                return makeFinishedFuture({});
+
+            key = { source.get(), page, qRound64(scale * ScalePrecision) };
+
+            if (const auto it = sharedRenders.find(key); it != sharedRenders.end())
+            {
+                it->IsPinned |= isPinned;
+                return it->Promise->future();
+            }
+
+            // It might have been rendered while the lock was being taken
+            if (std::optional<QImage> image = renderCache.object(page, scale); image)
+                return makeFinishedFuture(*image);
+
+            promise = std::make_shared<QPromise<QImage>>();
+            promise->start();
+            sharedRenders.insert(key, { promise, {}, isPinned, false });
+        }
+
+        // NOTE: the continuations might run right away, so the lock is not held here
+        const auto finish = [this, key, source, page, scale, promise](const QImage& image)
+        {
+            bool isCached = false;
+
+            {
+                const QMutexLocker locker(&sharedRendersMutex);
+
+                // Images of a replaced document do not belong to the cache anymore
+                if (!image.isNull() && document == source)
+                    isCached = renderCache.insert(page, scale, new QImage(image));
+
+                if (const auto it = sharedRenders.constFind(key); it != sharedRenders.cend() && it->Promise == promise)
+                    sharedRenders.erase(it);
+            }
+
+            // The scheduler belongs to the owner thread, the timer is just an object living there
+            if (isCached)
+                QMetaObject::invokeMethod(&dequeueDelayTimer, [this] { if (scheduler) scheduler->reclaim(); }, Qt::QueuedConnection);
+
+            promise->addResult(image);
+            promise->finish();
+        };
+
+        QFuture<QImage> rendering = source->render(page, scale);
+
+        {
+            const QMutexLocker locker(&sharedRendersMutex);
+
+            if (const auto it = sharedRenders.find(key); it != sharedRenders.end() && it->Promise == promise)
+            {
+                it->Source = rendering;
+
+                // Released before the render has even started
+                if (it->IsReleased && !it->IsPinned)
+                    rendering.cancel();
+            }
+        }
+
+        rendering
+            .then(QtFuture::Launch::Sync, [finish](const QImage& image) { finish(image); })
+            .onCanceled([finish] { finish({}); });
+
+        return promise->future();
+    }
+
+    // The views do not need the render anymore, it is stopped if nobody else waits for it
+    void releaseSharedRender(const int page, const qreal scale)
+    {
+        const QMutexLocker locker(&sharedRendersMutex);
+
+        const auto it = sharedRenders.find({ document.get(), page, qRound64(scale * ScalePrecision) });
+
+        if (it == sharedRenders.end() || it->IsPinned)
+            return;
+
+        it->IsReleased = true;
+        it->Source.cancel();
+    }
+
+    // Cache keys and shared render keys are the same, so callers sharing a render find each other's image
+    static qreal quantizeScale(const qreal scale)
+    {
+        return qreal(qRound64(scale * ScalePrecision)) / ScalePrecision;
+    }
+
+    void waitSharedRenders()
+    {
+        QList<QFuture<QImage>> pending;
+
+        {
+            const QMutexLocker locker(&sharedRendersMutex);
+
+            for (const SharedRender& render : std::as_const(sharedRenders))
+                pending.append(render.Promise->future());
+        }
+
+        for (QFuture<QImage>& future : pending)
+            future.waitForFinished();
+    }
+
+    static QFuture<QImage> makeFinishedFuture(const QImage& image)
+    {
+        QPromise<QImage> promise;
+        promise.start();
+        promise.addResult(image);
+        promise.finish();
+        return promise.future();
+    }
+
+    void addFeedback(DocumentRenderFeedback* feedback)
+    {
+        if (!feedbacks.contains(feedback))
+            feedbacks.append(feedback);
+    }
+
+    // Forgets the feedback everywhere, requests left without feedbacks are dropped
+    void removeFeedback(DocumentRenderFeedback* feedback)
+    {
+        feedbacks.removeAll(feedback);
+
+        if (renderState)
+        {
+            renderState->Request.Feedbacks.removeAll(feedback);
+
+            if (renderState->Request.Feedbacks.isEmpty())
+                cancelRender();
+        }
+
+        for (RenderRequest& request : requests)
+            request.Feedbacks.removeAll(feedback);
+
+        std::erase_if(requests, [](const RenderRequest& request) { return request.Feedbacks.isEmpty(); });
+
+        if (!renderState)
+            tryDequeueRenderRequestDelayed();
+    }
+
+    std::optional<QImage> requestThumbnail(const int page) const
     {
-        if (auto* image = renderCache.nearestObject(page, scale); image)
+        if (const QImage* image = thumbnails.object(page); image)
             return *image;
 
         return std::nullopt;
     }
 
+    void resetThumbnails()
+    {
+        cancelThumbnail();
+        thumbnails.reset(document.get(), thumbnailBudget);
+
+        tryDequeueRenderRequest();
+    }
+
+    // Render and thumbnail slots are released once they are finished or canceled
+    void cancelRender()
+    {
+        if (!renderState)
+            return;
+
+        if (renderState->IsShared)
+            releaseSharedRender(renderState->Request.Page, renderState->Request.Scale);
+
+        renderState.reset();
+        releaseSlot();
+    }
+
+    void cancelThumbnail()
+    {
+        if (!thumbnailRunning)
+            return;
+
+        thumbnailFuture.cancelChain();
+        thumbnailFuture = {};
+        thumbnailRunning = false;
+        ++thumbnailSerial;
+        releaseSlot();
+    }
+
+private:
+    std::optional<QImage> findNearestImage(const int page, const qreal scale) const
+    {
+        if (std::optional<QImage> image = renderCache.nearestObject(page, scale); image)
+            return image;
+
+        // The final fallback, so no page is painted blank after the thumbnails pass
+        return requestThumbnail(page);
+    }
+
+    // Expected render time in ms, 0 if the document has not been rendered yet
+    qreal predictRenderTime(const int page, const qreal scale) const
+    {
+        const QSizeF size = document->pagePointSize(page) * scale;
+        return document->renderCost(page) * size.width() * size.height() / 1'000'000;
+    }
+
+    // Scale at which the page is rendered within the deadline, nullopt if the requested one is fast enough
+    // or a good enough image is at hand already
+    std::optional<qreal> findPreviewScale(const int page, const qreal scale, const std::optional<QImage>& nearestImage) const
+    {
+        const qreal time = predictRenderTime(page, scale);
+
+        if (time <= FirstImageDeadline)
+            return std::nullopt;
+
+        // Render time is proportional to the area
+        const qreal previewScale = scale * std::sqrt(FirstImageDeadline / time);
+
+        if (nearestImage && nearestImage->width() >= document->pagePointSize(page).width() * previewScale)
+            return std::nullopt;
+
+        return previewScale;
+    }
+
+    void releaseSlot() const
+    {
+        if (scheduler)
+            scheduler->release(this);
+    }
+
+    // Thumbnails are rendered one by one, only while there are no actual requests
+    bool startThumbnail()
+    {
+        const auto isRenderable = [this](const int page) { return document->isPageSizeKnown(page); };
+
+        int page = -1;
+        qreal scale = 0.0;
+
+        // Zero-area pages are not rendered, a 0x0 image would fail every time
+        while ((page = thumbnails.nextMissing(lastRequestedPage, isRenderable)) != -1)
+        {
+            scale = thumbnails.scale(document->pagePointSize(page));
+
+            if (!(document->pagePointSize(page) * scale).toSize().isEmpty())
+                break;
+
+            thumbnails.skip(page);
+        }
+
+        if (page == -1)
+            return false;
+
+        thumbnailRunning = true;
+
+        const int serial = ++thumbnailSerial;
+
+        thumbnailFuture =
+            document->render(page, scale)
+            .then([](const QImage& image) { return image.convertToFormat(QImage::Format_RGB16); })
+            .then(QThread::currentThread(), [this, page, serial](QImage image)
+            {
+                finishThumbnail(page, serial, std::move(image));
+            })
+            .onCanceled(QThread::currentThread(), [this, page, serial]
+            {
+                finishThumbnail(page, serial, QImage());
+            });
+
+        return true;
+    }
+
+    // A failed page is recorded as such, so the idle loop does not pick it again and again
+    void finishThumbnail(const int page, const int serial, QImage image)
+    {
+        // Canceled on purpose, the page is still missing
+        if (!thumbnailRunning || serial != thumbnailSerial)
+            return;
+
+        const bool isReady = !image.isNull();
+
+        thumbnails.insert(page, std::move(image));
+        thumbnailFuture = {};
+        thumbnailRunning = false;
+        releaseSlot();
+
+        // Only a page painted without any image needs to be repainted
+        if (isReady && !renderCache.nearestObject(page, 1.0))
+        {
+            for (const DocumentRenderFeedback* feedback : std::as_const(feedbacks))
+            {
+                if (feedback->isActual(page))
+                    feedback->imageReady(page);
+            }
+        }
+
+        tryDequeueRenderRequest();
+    }
+
     void enqueueRenderRequest(RenderRequest&& request)
     {
         requests.emplace_back(std::move(request));
@@ -178,15 +743,15 @@ private:
 
     void tryDequeueRenderRequest()
     {
-        if (renderState && !renderState->Request.Feedback->isActual(renderState->Request.Page))
+        if (renderState && !renderState->Request.isActual())
         {
-            renderState.reset();
+            cancelRender();
         }
 
         // Erase unactual requests
         const auto firstActualIt = std::find_if(requests.begin(), requests.end(), [](const RenderRequest& request)
         {
-            return request.Feedback->isActual(request.Page);
+            return request.isActual();
         });
 
         const auto prevSize = requests.size();
@@ -194,56 +759,220 @@ private:
 
         if (const auto diff = prevSize - requests.size(); diff) qDebug() << "Erased" << diff << "elements";
 
-        if (requests.empty()) return;
+        // Renderers of all documents share the scheduler's slots, otherwise the work is started right away
+        if (scheduler)
+            scheduler->wake();
+        else
+            (void) startWork();
+    }
+
+    bool startRender()
+    {
+        // Cheap pages first, the screen gets filled faster; the first request is always actual
+        const auto requestIt = std::ranges::min_element(requests, {}, [this](const RenderRequest& request)
+        {
+            return request.isActual() ? predictRenderTime(request.Page, request.Scale) : std::numeric_limits<qreal>::infinity();
+        });
 
-        // Take first request in queue
-        RenderRequest request = std::move(requests.front());
-        requests.pop_front();
+        RenderRequest request = std::move(*requestIt);
+        requests.erase(requestIt);
 
+        if (const QSize size = (document->pagePointSize(request.Page) * request.Scale).toSize(); qint64(size.width()) * size.height() >= BandedRenderArea)
+            return startBandedRender(std::move(request), size);
+
+        // NOTE: the image is cached by the shared render itself
         QFuture<void> future =
-            document->render(request.Page, request.Scale * pixelRatio)
+            shareRender(request.Page, request.Scale, false)
             .then(QThread::currentThread(), [this, request](const QImage& image){
+                // Feedbacks might have joined or left the request while it was being rendered
+                if (!renderState || !(renderState->Request == request))
+                    return;
+
+                if (!image.isNull())
+                    renderState->Request.imageReady();
+
+                cancelRender();
+                tryDequeueRenderRequest();
+            });
+
+        renderState.emplace(request, future);
+        renderState->IsShared = true;
+        return true;
+    }
+
+    // Large pages take long to render, so their visible top is shown as soon as its bands are ready
+    bool startBandedRender(RenderRequest request, const QSize size)
+    {
+        const int bandHeight = std::max(MinBandHeight, size.height() / 8);
+        const QFuture<QImage> bands = document->renderBands(request.Page, request.Scale, bandHeight);
+
+        // Bands are drawn over the nearest image, scaled up
+        QImage canvas(size, QImage::Format_ARGB32_Premultiplied);
+        canvas.fill(Qt::white);
+        canvas.setText(DocumentRenderer::PartialImageKey, "1");
+
+        if (const std::optional<QImage> nearest = findNearestImage(request.Page, request.Scale); nearest)
+        {
+            QPainter painter(&canvas);
+            painter.drawImage(canvas.rect(), *nearest);
+        }
+
+        auto watcher = std::make_unique<QFutureWatcher<QImage>>();
+
+        QObject::connect(watcher.get(), &QFutureWatcherBase::resultReadyAt, [this, request, source = watcher.get()](const int index)
+        {
+            if (!renderState || !(renderState->Request == request))
+                return;
+
+            drawBand(renderState->Canvas, source->resultAt(index));
+            renderState->DrawnBands.insert(index);
+            renderState->Request.imageReady();
+        });
+
+        QFuture<void> future =
+            bands.then(QThread::currentThread(), [this, request](const QFuture<QImage>& finished)
+            {
+                if (!renderState || !(renderState->Request == request))
+                    return;
+
+                // Some bands might have not been reported yet
+                const QList<QImage> bands = finished.results();
+                QRegion covered;
+
+                for (int index = 0; index < bands.size(); ++index)
+                {
+                    if (!renderState->DrawnBands.contains(index))
+                        drawBand(renderState->Canvas, bands[index]);
+
+                    covered += QRect(bands[index].offset(), bands[index].size());
+                }
+
+                // NOTE: the canvas is not shared by now, so dropping the mark does not copy it
+                QImage image = std::move(renderState->Canvas);
+                image.setText(DocumentRenderer::PartialImageKey, QString());
+
+                if (!(QRegion(image.rect()) - covered).isEmpty())
+                {
+                    cancelRender();
+                    tryDequeueRenderRequest();
+                    return;
+                }
+
+                renderState->Canvas = image;
                 (void) renderCache.insert(request.Page, request.Scale, new QImage(image));
-                request.Feedback->imageReady(request.Page);
 
-                renderState.reset();
+                if (scheduler)
+                    scheduler->reclaim();
+
+                renderState->Request.imageReady();
+
+                cancelRender();
+                tryDequeueRenderRequest();
+            })
+            .onCanceled(QThread::currentThread(), [this, request]
+            {
+                // A band has failed; a render canceled on purpose has been dropped or replaced already
+                if (!renderState || !(renderState->Request == request) || !renderState->Bands->isCanceled())
+                    return;
+
+                cancelRender();
                 tryDequeueRenderRequest();
             });
 
         renderState.emplace(request, future);
+        renderState->Canvas = std::move(canvas);
+        renderState->Bands = std::move(watcher);
+        renderState->Bands->setFuture(bands);
+        return true;
+    }
+
+    static void drawBand(QImage& canvas, const QImage& band)
+    {
+        QPainter painter(&canvas);
+        painter.setCompositionMode(QPainter::CompositionMode_Source);
+        painter.drawImage(band.offset(), band);
     }
 
+    static constexpr qint64 BandedRenderArea = 8'000'000; // pixels
+    static constexpr qreal FirstImageDeadline = 100; // ms
+    static constexpr int MinBandHeight = 256;
+
     friend class StandardDocumentRenderer;
 
     std::shared_ptr<const Document> document;
 
-    qreal pixelRatio = 1.0;
-
     QTimer dequeueDelayTimer;
 
     mutable RenderCache renderCache;
 
+    ThumbnailStore thumbnails;
+    std::size_t thumbnailBudget = 0;
+    QFuture<void> thumbnailFuture;
+    bool thumbnailRunning = false;
+    int thumbnailSerial = 0; // tells the running pass from the canceled ones
+
+    // NOTE: thumbnails are prioritized around the last requested page
+    int lastRequestedPage = 0;
+
+    QList<DocumentRenderFeedback*> feedbacks;
+
     std::list<RenderRequest> requests;
     std::optional<RenderState> renderState;
+
+    std::shared_ptr<RenderScheduler> scheduler;
+
+    // Device scale is rounded to ScalePrecision
+    struct SharedRenderKey
+    {
+        const Document* Source = nullptr; // alive as long as its render is
+        int Page = 0;
+        qint64 Scale = 0;
+
+        bool operator==(const SharedRenderKey&) const = default;
+
+        friend size_t qHash(const SharedRenderKey& key, const size_t seed = 0)
+        {
+            return qHashMulti(seed, key.Source, key.Page, key.Scale);
+        }
+    };
+
+    struct SharedRender
+    {
+        std::shared_ptr<QPromise<QImage>> Promise;
+        QFuture<QImage> Source; // the document's render, set right after the entry
+        bool IsPinned = false;  // joined by somebody who can not cancel it
+        bool IsReleased = false;
+    };
+
+    static constexpr qreal ScalePrecision = 1024;
+
+    QHash<SharedRenderKey, SharedRender> sharedRenders;
+    mutable QMutex sharedRendersMutex;
 };
 
 StandardDocumentRenderer::StandardDocumentRenderer()
     : d(std::make_unique<Private>())
 {
     setRenderCacheLimit(512 /*MiB*/ * 1024 /*KiB*/ * 1024 /*B*/);
+    setThumbnailCacheLimit(32 /*MiB*/ * 1024 /*KiB*/ * 1024 /*B*/);
 }
 
 StandardDocumentRenderer::~StandardDocumentRenderer() = default;
 
-auto StandardDocumentRenderer::setPixelRatio(qreal ratio) const -> void
+auto StandardDocumentRenderer::setRenderCacheLimit(qreal bytes) const -> void
 {
-    // TODO: invalidate cache (?) or take ratio in account with {scale} (!)
-    d->pixelRatio = ratio;
+    d->renderCache.setLimit(bytes);
 }
 
-auto StandardDocumentRenderer::setRenderCacheLimit(qreal bytes) const -> void
+auto StandardDocumentRenderer::setThumbnailCacheLimit(qreal bytes) const -> void
 {
-    d->renderCache.setLimit(bytes);
+    d->thumbnailBudget = static_cast<std::size_t>(bytes);
+    d->resetThumbnails();
+}
+
+auto StandardDocumentRenderer::setScheduler(const std::shared_ptr<StandardRenderScheduler>& scheduler) const -> void
+{
+    d->setScheduler(this, scheduler ? scheduler->d : nullptr);
 }
 
 auto StandardDocumentRenderer::setRenderDelay(int ms) const -> void
@@ -255,14 +984,41 @@ auto StandardDocumentRenderer::setDocument(std::shared_ptr<const Document> docum
 {
     // Reset active state
     d->dequeueDelayTimer.stop();
-    d->renderState.reset();
+    d->cancelRender();
     d->requests.clear();
-    d->renderCache.clear();
+    d->lastRequestedPage = 0;
+
+    // Shared renders still running keep the old document alive, but do not reach the cache anymore
+    {
+        const QMutexLocker locker(&d->sharedRendersMutex);
+        d->document = std::move(document);
+        d->renderCache.clear();
+    }
+
+    d->resetThumbnails();
+}
 
-    d->document = document;
+auto StandardDocumentRenderer::requestPageRender(int page, qreal scale, qreal pixelRatio, DocumentRenderFeedback* feedback) const -> std::optional<QImage>
+{
+    return d->request(page, scale, pixelRatio, feedback);
+}
+
+auto StandardDocumentRenderer::render(int page, qreal scale) const -> QFuture<QImage>
+{
+    return d->render(page, scale);
+}
+
+auto StandardDocumentRenderer::requestThumbnail(int page) const -> std::optional<QImage>
+{
+    return d->requestThumbnail(page);
+}
+
+auto StandardDocumentRenderer::addFeedback(DocumentRenderFeedback* feedback) -> void
+{
+    d->addFeedback(feedback);
 }
 
-auto StandardDocumentRenderer::requestPageRender(int page, qreal scale, DocumentRenderFeedback* feedback) const -> std::optional<QImage>
+auto StandardDocumentRenderer::removeFeedback(DocumentRenderFeedback* feedback) -> void
 {
-    return d->request(page, scale, feedback);
+    d->removeFeedback(feedback);
 }
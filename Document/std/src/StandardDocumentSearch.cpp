@@ -0,0 +1,327 @@
+#include "StandardDocumentSearch.h"
+
+#include <QtConcurrent/QtConcurrentRun>
+#include <QMutex>
+#include <QPromise>
+#include <QThread>
+#include <QThreadPool>
+
+#include <Document/API/Document.h>
+
+#include "StandardDocumentParser.h"
+
+namespace
+{
+    constexpr int ShardSize = 32; // pages
+
+    struct Token
+    {
+        qsizetype From;
+        qsizetype To;
+    };
+
+    // Scripts with no spaces between words, which can not be told apart without a dictionary
+    bool isUnspaced(const QChar c)
+    {
+        switch (c.script())
+        {
+            case QChar::Script_Han:
+            case QChar::Script_Hiragana:
+            case QChar::Script_Katakana:
+            case QChar::Script_Thai:
+            case QChar::Script_Lao:
+            case QChar::Script_Khmer:
+            case QChar::Script_Myanmar:
+                return true;
+            default:
+                return false;
+        }
+    }
+
+    // Words are maximal runs of letters and digits, characters of unspaced scripts are words of their own
+    // NOTE: characters outside the BMP are surrogate pairs, which are not letters here
+    std::optional<Token> nextToken(const QString& text, qsizetype from)
+    {
+        while (from < text.size() && !text[from].isLetterOrNumber())
+            ++from;
+
+        if (from == text.size())
+            return std::nullopt;
+
+        if (isUnspaced(text[from]))
+            return Token { from, from + 1 };
+
+        qsizetype to = from;
+        while (to < text.size() && text[to].isLetterOrNumber() && !isUnspaced(text[to]))
+            ++to;
+
+        return Token { from, to };
+    }
+
+    QString term(const QString& text, const Token& token)
+    {
+        return text.sliced(token.From, token.To - token.From).toCaseFolded();
+    }
+
+    QStringList terms(const QString& text)
+    {
+        QStringList terms;
+
+        for (auto token = nextToken(text, 0); token; token = nextToken(text, token->To))
+            terms.append(term(text, *token));
+
+        return terms;
+    }
+}
+
+struct StandardDocumentSearch::Private
+{
+    struct Posting
+    {
+        int Page;
+        int Offset;
+    };
+
+    struct Shard
+    {
+        int FirstPage;
+        QStringList Texts;
+        QHash<QString, QList<Posting>> Postings;
+    };
+
+    struct Query
+    {
+        QStringList Terms;
+        QPromise<DocumentSearchHit> Promise;
+        qsizetype NextShard = 0;
+
+        // Serializes draining, so the hits are reported in page order
+        QMutex Mutex;
+    };
+
+    // State shared with the worker threads, outlives the document it was built for
+    struct Index
+    {
+        std::shared_ptr<const Document> Source;
+        std::shared_ptr<const StandardDocumentParser> Parser;
+        std::atomic_bool Canceled = false;
+
+        QMutex Mutex;
+        QList<std::shared_ptr<const Shard>> Shards; // null until built
+        QList<std::shared_ptr<Query>> Queries;
+
+        [[nodiscard]] bool isBuilt()
+        {
+            QMutexLocker lock(&Mutex);
+            return std::ranges::all_of(Shards, [](const auto& shard) { return shard != nullptr; });
+        }
+    };
+
+    Private()
+    {
+        pool.setMaxThreadCount(std::max(1, QThread::idealThreadCount() / 2));
+    }
+
+    ~Private()
+    {
+        cancel();
+    }
+
+    void build(std::shared_ptr<const Document> document)
+    {
+        cancel();
+
+        index = std::make_shared<Index>();
+        index->Source = std::move(document);
+        index->Parser = parser;
+
+        if (!index->Source)
+            return;
+
+        const int pageCount = static_cast<int>(index->Source->pageCount());
+        const int shardCount = (pageCount + ShardSize - 1) / ShardSize;
+
+        index->Shards.resize(shardCount);
+
+        for (int i = 0; i < shardCount; ++i)
+        {
+            const int firstPage = i * ShardSize;
+            const int lastPage = std::min(firstPage + ShardSize, pageCount) - 1;
+
+            std::ignore = QtConcurrent::run(&pool, [index = index, i, firstPage, lastPage]
+            {
+                if (index->Canceled)
+                    return;
+
+                auto shard = std::make_shared<Shard>(buildShard(*index, firstPage, lastPage));
+
+                QList<std::shared_ptr<Query>> queries;
+                {
+                    QMutexLocker lock(&index->Mutex);
+                    index->Shards[i] = std::move(shard);
+                    queries = index->Queries;
+                }
+
+                for (const auto& query : queries)
+                    drain(*index, query);
+            });
+        }
+    }
+
+    void cancel() const
+    {
+        if (!index)
+            return;
+
+        index->Canceled = true;
+
+        QMutexLocker lock(&index->Mutex);
+
+        for (const auto& query : std::as_const(index->Queries))
+            query->Promise.future().cancel();
+
+        index->Queries.clear();
+    }
+
+    [[nodiscard]] QFuture<DocumentSearchHit> find(const QString& text) const
+    {
+        auto query = std::make_shared<Query>();
+        query->Terms = terms(text);
+        query->Promise.start();
+
+        QFuture<DocumentSearchHit> future = query->Promise.future();
+
+        if (!index || query->Terms.isEmpty())
+        {
+            query->Promise.finish();
+            return future;
+        }
+
+        {
+            QMutexLocker lock(&index->Mutex);
+            index->Queries.append(query);
+        }
+
+        pool.start([index = index, query]
+        {
+            drain(*index, query);
+        });
+
+        return future;
+    }
+
+    // Reports hits of every built shard the query has not seen yet, stops at the first one not built
+    static void drain(Index& index, const std::shared_ptr<Query>& query)
+    {
+        QMutexLocker queryLock(&query->Mutex);
+
+        while (!index.Canceled && !query->Promise.isCanceled())
+        {
+            std::shared_ptr<const Shard> shard;
+            {
+                QMutexLocker lock(&index.Mutex);
+
+                if (query->NextShard == index.Shards.size())
+                    break;
+
+                shard = index.Shards[query->NextShard];
+            }
+
+            if (!shard)
+                return;
+
+            const QList<DocumentSearchHit> hits = findHits(*shard, query->Terms);
+
+            if (!hits.isEmpty())
+                query->Promise.addResults(hits);
+
+            ++query->NextShard;
+        }
+
+        query->Promise.finish();
+
+        QMutexLocker lock(&index.Mutex);
+        index.Queries.removeOne(query);
+    }
+
+    static Shard buildShard(const Index& index, const int firstPage, const int lastPage)
+    {
+        Shard shard { .FirstPage = firstPage };
+
+        for (int page = firstPage; page <= lastPage && !index.Canceled; ++page)
+        {
+            std::optional<QString> stored = index.Parser ? index.Parser->layoutText(*index.Source, page) : std::nullopt;
+            const QString text = stored ? std::move(*stored) : index.Source->text(page);
+
+            for (auto token = nextToken(text, 0); token; token = nextToken(text, token->To))
+                shard.Postings[term(text, *token)].append({ page, static_cast<int>(token->From) });
+
+            shard.Texts.append(text);
+        }
+
+        return shard;
+    }
+
+    static QList<DocumentSearchHit> findHits(const Shard& shard, const QStringList& terms)
+    {
+        const auto it = shard.Postings.constFind(terms.first());
+
+        if (it == shard.Postings.cend())
+            return {};
+
+        QList<DocumentSearchHit> hits;
+
+        // Postings are sorted by page and offset, the rest of the phrase is verified against the page text
+        for (const Posting& posting : *it)
+        {
+            const QString& text = shard.Texts[posting.Page - shard.FirstPage];
+
+            Token last = *nextToken(text, posting.Offset);
+            bool matches = true;
+
+            for (qsizetype i = 1; i < terms.size() && matches; ++i)
+            {
+                const auto token = nextToken(text, last.To);
+                matches = token && term(text, *token) == terms[i];
+
+                if (matches)
+                    last = *token;
+            }
+
+            if (matches)
+                hits.append({ posting.Page, posting.Offset, static_cast<int>(last.To - posting.Offset) });
+        }
+
+        return hits;
+    }
+
+    mutable QThreadPool pool;
+    std::shared_ptr<Index> index;
+    std::shared_ptr<const StandardDocumentParser> parser;
+};
+
+StandardDocumentSearch::StandardDocumentSearch()
+    : d(std::make_unique<Private>())
+{}
+
+StandardDocumentSearch::~StandardDocumentSearch() = default;
+
+auto StandardDocumentSearch::setParser(std::shared_ptr<const StandardDocumentParser> parser) -> void
+{
+    d->parser = std::move(parser);
+}
+
+auto StandardDocumentSearch::setDocument(std::shared_ptr<const Document> document) -> void
+{
+    d->build(std::move(document));
+}
+
+auto StandardDocumentSearch::find(const QString& query) const -> QFuture<DocumentSearchHit>
+{
+    return d->find(query);
+}
+
+auto StandardDocumentSearch::isIndexed() const -> bool
+{
+    return d->index && d->index->isBuilt();
+}
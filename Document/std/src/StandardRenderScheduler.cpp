@@ -0,0 +1,29 @@
+#include "StandardRenderScheduler.h"
+
+#include <QThread>
+
+#include "scheduler/RenderScheduler.h"
+
+StandardRenderScheduler::StandardRenderScheduler()
+    : d(std::make_shared<RenderScheduler>())
+{
+    setConcurrency(std::max(1, QThread::idealThreadCount() / 2));
+    setMemoryLimit(1024 /*MiB*/ * 1024 /*KiB*/ * 1024 /*B*/);
+}
+
+StandardRenderScheduler::~StandardRenderScheduler() = default;
+
+auto StandardRenderScheduler::setConcurrency(int renders) const -> void
+{
+    d->setConcurrency(renders);
+}
+
+auto StandardRenderScheduler::setMemoryLimit(qreal bytes) const -> void
+{
+    d->setMemoryLimit(static_cast<qsizetype>(bytes));
+}
+
+auto StandardRenderScheduler::setActiveRenderer(const StandardDocumentRenderer* renderer) const -> void
+{
+    d->setActive(renderer);
+}
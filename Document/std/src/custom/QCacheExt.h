@@ -163,6 +163,7 @@ public:
         _onEraseFn = onEraseFn;
     }
     inline qsizetype totalCost() const noexcept { return total; }
+    void shrink(qsizetype m) noexcept(std::is_nothrow_destructible_v<Node>) { trim(m); } // customization
 
     inline qsizetype size() const noexcept { return qsizetype(d.size); }
     inline qsizetype count() const noexcept { return qsizetype(d.size); }
@@ -0,0 +1,152 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <memory>
+
+#include <QCache>
+#include <QMutex>
+
+#include "PageLayout.h"
+
+// Page layouts shared between threads.
+//
+// Pages are spread over independently locked shards, so concurrent readers of different pages
+// rarely wait for each other. Layouts are handed out as shared pointers: an evicted layout stays
+// alive while somebody still reads it.
+//
+// Clearing starts a new generation: layouts built or loaded for the previous one (e.g. of a replaced document)
+// are not cached when they arrive late.
+//
+// The memory budget is common to all the shards, so a layout of any size up to the budget is cached;
+// when it is exceeded, the least recently used layouts of the shards are evicted in turn.
+class LayoutCache
+{
+public:
+    using Layout = std::shared_ptr<const PageLayout>;
+
+    void setMaxCost(const qsizetype bytes)
+    {
+        m_maxCost = bytes;
+
+        for (Shard& shard : m_shards)
+        {
+            const QMutexLocker locker(&shard.Mutex);
+            shard.Cache.setMaxCost(bytes);
+        }
+
+        trim();
+    }
+
+    [[nodiscard]] Layout find(const int page) const
+    {
+        Shard& shard = shardOf(page);
+        const QMutexLocker locker(&shard.Mutex);
+
+        const Layout* layout = shard.Cache.object(page);
+        return layout ? *layout : nullptr;
+    }
+
+    [[nodiscard]] bool contains(const int page) const
+    {
+        const Shard& shard = shardOf(page);
+        const QMutexLocker locker(&shard.Mutex);
+        return shard.Cache.contains(page);
+    }
+
+    [[nodiscard]] int generation() const
+    {
+        return m_generation.load(std::memory_order_acquire);
+    }
+
+    // NOTE: the layout is returned even if it is too big or too late to be cached
+    Layout insert(const int page, PageLayout layout, const int generation)
+    {
+        const qsizetype cost = layout.sizeInBytes();
+        auto shared = std::make_shared<const PageLayout>(std::move(layout));
+
+        {
+            Shard& shard = shardOf(page);
+            const QMutexLocker locker(&shard.Mutex);
+
+            // Checked under the shard lock, so clear() either sees the layout or makes it too late
+            if (generation == m_generation.load(std::memory_order_acquire))
+                (void) shard.Cache.insert(page, new Layout(shared), cost);
+        }
+
+        trim();
+        return shared;
+    }
+
+    void clear()
+    {
+        m_generation.fetch_add(1, std::memory_order_acq_rel);
+
+        for (Shard& shard : m_shards)
+        {
+            const QMutexLocker locker(&shard.Mutex);
+            shard.Cache.clear();
+        }
+    }
+
+private:
+    static constexpr int ShardCount = 16;
+
+    struct Shard
+    {
+        QMutex Mutex;
+        QCache<int, Layout> Cache;
+    };
+
+    [[nodiscard]] qsizetype totalCost() const
+    {
+        qsizetype total = 0;
+
+        for (const Shard& shard : m_shards)
+        {
+            const QMutexLocker locker(&shard.Mutex);
+            total += shard.Cache.totalCost();
+        }
+
+        return total;
+    }
+
+    // NOTE: QCache evicts only to fit its own limit, so a shard is shrunk for a moment to drop its oldest layouts
+    void trim()
+    {
+        for (qsizetype excess = totalCost() - m_maxCost; excess > 0; )
+        {
+            qsizetype evicted = 0;
+
+            for (int i = 0; i < ShardCount && excess > 0; ++i)
+            {
+                Shard& shard = m_shards[m_nextTrimmed++ % ShardCount];
+                const QMutexLocker locker(&shard.Mutex);
+
+                const qsizetype before = shard.Cache.totalCost();
+                shard.Cache.setMaxCost(before - std::min(excess, before));
+                shard.Cache.setMaxCost(m_maxCost);
+
+                const qsizetype dropped = before - shard.Cache.totalCost();
+                evicted += dropped;
+                excess -= dropped;
+            }
+
+            // Other threads might be inserting meanwhile, they trim after themselves
+            if (evicted == 0)
+                break;
+        }
+    }
+
+    // Neighbouring pages are used together, so they go to different shards
+    [[nodiscard]] Shard& shardOf(const int page) const
+    {
+        return m_shards[static_cast<unsigned>(page) % ShardCount];
+    }
+
+    mutable std::array<Shard, ShardCount> m_shards;
+    std::atomic<qsizetype> m_maxCost = 0;
+    std::atomic_uint m_nextTrimmed = 0;
+    std::atomic_int m_generation = 0;
+};
@@ -0,0 +1,266 @@
+#include "LayoutStore.h"
+
+#include <QLockFile>
+#include <QSaveFile>
+
+#include <cstring>
+
+namespace
+{
+    constexpr char Magic[8] = { 'Q', 'P', 'V', 'L', 'A', 'Y', 'O', 'T' };
+    constexpr uint32_t Version = 2;
+    constexpr uint32_t ByteOrderMark = 0x01020304;
+
+    constexpr qint64 BlockAlignment = 8;
+
+    // Other instances hold the lock for one append at most
+    constexpr int LockTimeout = 1000; // ms
+
+    // FNV-1a, stable across machines and Qt versions unlike qHashBits
+    uint64_t checksum(const std::span<const std::byte> bytes)
+    {
+        uint64_t hash = 0xcbf29ce484222325;
+
+        for (const std::byte byte : bytes)
+            hash = (hash ^ static_cast<uint64_t>(byte)) * 0x100000001b3;
+
+        return hash;
+    }
+}
+
+QString LayoutStore::fileName(const QByteArray& fingerprint)
+{
+    // Builds with other formats use other files, so nobody rewrites a file somebody else has mapped
+    return QStringLiteral("%1.v%2.%3.layout").arg(QString::fromLatin1(fingerprint.toHex())).arg(Version).arg(PageLayout::FormatVersion);
+}
+
+LayoutStore::~LayoutStore() = default;
+
+// NOTE: several instances may use the same file: it is only appended to under the lock file, and a broken one is
+// replaced by a new file rather than truncated, so mappings of other instances stay valid
+bool LayoutStore::open(const QString& path, const int pageCount)
+{
+    close();
+
+    m_lockPath = path + ".lock";
+    QLockFile lock(m_lockPath);
+
+    if (!lock.tryLock(LockTimeout))
+        return false;
+
+    if (!openFile(path, pageCount) && !(create(path, pageCount) && openFile(path, pageCount)))
+    {
+        close();
+        return false;
+    }
+
+    return true;
+}
+
+bool LayoutStore::openFile(const QString& path, const int pageCount)
+{
+    const auto file = std::make_shared<QFile>(path);
+
+    if (!file->open(QIODevice::ReadWrite))
+        return false;
+
+    FileHeader header {};
+
+    if (file->read(reinterpret_cast<char*>(&header), sizeof(header)) != sizeof(header) || !isValid(header, pageCount))
+        return false;
+
+    m_entries.resize(pageCount);
+
+    const qint64 tableSize = pageCount * static_cast<qint64>(sizeof(PageEntry));
+
+    if (file->read(reinterpret_cast<char*>(m_entries.data()), tableSize) != tableSize)
+    {
+        m_entries.clear();
+        return false;
+    }
+
+    m_checks = QList<Check>(pageCount, Check::Unchecked);
+
+    m_file = file;
+
+    // Layouts written by previous sessions are used right from the mapping
+    if (uchar* data = file->map(0, file->size()); data)
+    {
+        m_mapping = std::shared_ptr<const std::byte[]>(reinterpret_cast<const std::byte*>(data), [file](const std::byte* data)
+        {
+            file->unmap(reinterpret_cast<uchar*>(const_cast<std::byte*>(data)));
+        });
+
+        m_mappingSize = file->size();
+    }
+
+    return true;
+}
+
+void LayoutStore::close()
+{
+    // NOTE: the file itself is closed once the last layout using its mapping is gone
+    m_file.reset();
+    m_mapping.reset();
+    m_mappingSize = 0;
+    m_entries.clear();
+    m_checks.clear();
+    m_lockPath.clear();
+}
+
+bool LayoutStore::isOpen() const
+{
+    return m_file != nullptr;
+}
+
+std::optional<PageLayout> LayoutStore::load(const int page) const
+{
+    if (!m_file)
+        return std::nullopt;
+
+    PageEntry entry {};
+    Check check = Check::Unchecked;
+
+    {
+        const QMutexLocker locker(&m_entriesMutex);
+
+        if (page < 0 || page >= m_entries.size())
+            return std::nullopt;
+
+        entry = m_entries[page];
+        check = m_checks[page];
+    }
+
+    if (entry.size == 0 || check == Check::Broken)
+        return std::nullopt;
+
+    std::shared_ptr<const std::byte[]> block;
+
+    if (m_mapping && entry.offset + entry.size <= static_cast<uint64_t>(m_mappingSize))
+    {
+        // Shares ownership of the mapping
+        block = std::shared_ptr<const std::byte[]>(m_mapping, m_mapping.get() + entry.offset);
+    }
+    else
+    {
+        // Stored during this session, past the mapped part of the file
+        const std::shared_ptr<std::byte[]> buffer(new std::byte[entry.size]);
+        const QMutexLocker locker(&m_fileMutex);
+
+        if (!m_file->seek(static_cast<qint64>(entry.offset)) || m_file->read(reinterpret_cast<char*>(buffer.get()), static_cast<qint64>(entry.size)) != static_cast<qint64>(entry.size))
+            return std::nullopt;
+
+        block = buffer;
+    }
+
+    // A damaged or partially written block is never used, layouts trust their indices
+    if (check == Check::Unchecked)
+    {
+        const bool isValid = checksum({ block.get(), static_cast<std::size_t>(entry.size) }) == entry.checksum;
+
+        {
+            const QMutexLocker locker(&m_entriesMutex);
+
+            // The entry might have been replaced meanwhile, its block is checked on its own first load
+            if (m_entries[page].offset == entry.offset)
+                m_checks[page] = isValid ? Check::Valid : Check::Broken;
+        }
+
+        if (!isValid)
+            return std::nullopt;
+    }
+
+    return PageLayout::fromBytes(block, static_cast<qsizetype>(entry.size));
+}
+
+void LayoutStore::store(const int page, const PageLayout& layout)
+{
+    if (!m_file)
+        return;
+
+    {
+        const QMutexLocker locker(&m_entriesMutex);
+
+        if (page < 0 || page >= m_entries.size() || m_entries[page].size != 0)
+            return;
+    }
+
+    const std::span<const std::byte> bytes = layout.bytes();
+
+    if (bytes.empty())
+        return;
+
+    // Other threads of this instance are kept out by the mutex, other instances by the lock file
+    const QMutexLocker fileLocker(&m_fileMutex);
+    QLockFile lock(m_lockPath);
+
+    if (!lock.tryLock(LockTimeout))
+        return;
+
+    const qint64 entryOffset = sizeof(FileHeader) + page * static_cast<qint64>(sizeof(PageEntry));
+
+    // Another instance might have stored the page meanwhile
+    PageEntry stored {};
+
+    if (!m_file->seek(entryOffset) || m_file->read(reinterpret_cast<char*>(&stored), sizeof(stored)) != sizeof(stored))
+        return;
+
+    if (stored.size != 0)
+    {
+        const QMutexLocker locker(&m_entriesMutex);
+        m_entries[page] = stored;
+        m_checks[page] = Check::Unchecked;
+        return;
+    }
+
+    // Appended at the actual end of the file, which other instances might have moved
+    const qint64 offset = (m_file->size() + BlockAlignment - 1) / BlockAlignment * BlockAlignment;
+
+    // The block is written before its table entry, so an interrupted write leaves the page just missing
+    if (!m_file->resize(offset) || !m_file->seek(offset) || m_file->write(reinterpret_cast<const char*>(bytes.data()), static_cast<qint64>(bytes.size())) != static_cast<qint64>(bytes.size()))
+        return;
+
+    if (!m_file->flush())
+        return;
+
+    const PageEntry entry { static_cast<uint64_t>(offset), static_cast<uint64_t>(bytes.size()), checksum(bytes) };
+
+    if (m_file->seek(entryOffset) && m_file->write(reinterpret_cast<const char*>(&entry), sizeof(entry)) == sizeof(entry))
+    {
+        const QMutexLocker locker(&m_entriesMutex);
+        m_entries[page] = entry;
+        m_checks[page] = Check::Unchecked;
+    }
+
+    (void) m_file->flush();
+}
+
+bool LayoutStore::isValid(const FileHeader& header, const int pageCount) const
+{
+    return std::memcmp(header.magic, Magic, sizeof(Magic)) == 0
+        && header.version == Version
+        && header.layoutVersion == PageLayout::FormatVersion
+        && header.byteOrder == ByteOrderMark
+        && header.pageCount == static_cast<uint32_t>(pageCount);
+}
+
+bool LayoutStore::create(const QString& path, const int pageCount) const
+{
+    FileHeader header {};
+    std::memcpy(header.magic, Magic, sizeof(Magic));
+    header.version = Version;
+    header.layoutVersion = PageLayout::FormatVersion;
+    header.byteOrder = ByteOrderMark;
+    header.pageCount = static_cast<uint32_t>(pageCount);
+
+    const QList<PageEntry> entries(pageCount, PageEntry {});
+    const qint64 tableSize = pageCount * static_cast<qint64>(sizeof(PageEntry));
+
+    // Replaces the file as a whole, instances that have mapped the old one keep using it
+    QSaveFile file(path);
+
+    return file.open(QIODevice::WriteOnly)
+        && file.write(reinterpret_cast<const char*>(&header), sizeof(header)) == sizeof(header)
+        && file.write(reinterpret_cast<const char*>(entries.constData()), tableSize) == tableSize
+        && file.commit();
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <QFile>
+#include <QMutex>
+
+#include "PageLayout.h"
+
+// Persistent storage of page layouts, one file per document.
+//
+// File format (native byte order, checked on open):
+//   FileHeader
+//   PageEntry[pageCount]  - location and checksum of each page's layout block, zero size if not stored yet
+//   layout blocks         - appended as pages get built, 8-byte aligned
+//
+// The file is memory mapped on open, so layouts stored by previous sessions are used in place
+// without being read or rebuilt.
+//
+// Loads and stores may be called from any thread, opening and closing may not run concurrently with them.
+class LayoutStore
+{
+public:
+    LayoutStore() = default;
+    ~LayoutStore();
+
+    // File name for the document fingerprint, it differs between file and layout format versions
+    [[nodiscard]] static QString fileName(const QByteArray& fingerprint);
+
+    // Opens or (re)creates the file, returns false if it is not usable
+    bool open(const QString& path, int pageCount);
+    void close();
+
+    [[nodiscard]] bool isOpen() const;
+
+    [[nodiscard]] std::optional<PageLayout> load(int page) const;
+    void store(int page, const PageLayout& layout);
+
+private:
+    struct FileHeader
+    {
+        char magic[8];
+        uint32_t version;
+        uint32_t layoutVersion;
+        uint32_t byteOrder;
+        uint32_t pageCount;
+    };
+
+    struct PageEntry
+    {
+        uint64_t offset;
+        uint64_t size;
+        uint64_t checksum;
+    };
+
+    [[nodiscard]] bool isValid(const FileHeader& header, int pageCount) const;
+    [[nodiscard]] bool openFile(const QString& path, int pageCount);
+    [[nodiscard]] bool create(const QString& path, int pageCount) const;
+
+    std::shared_ptr<QFile> m_file;
+    std::shared_ptr<const std::byte[]> m_mapping; // keeps the file mapped while layouts use it
+    qsizetype m_mappingSize = 0;
+    QString m_lockPath;
+
+    // NOTE: file reads and writes are done under their own lock, so loads from the mapping do not wait for them
+    mutable QMutex m_entriesMutex;
+    QList<PageEntry> m_entries;
+
+    // Blocks are verified against their checksums once, on the first load
+    enum class Check : uint8_t { Unchecked, Valid, Broken };
+    mutable QList<Check> m_checks;
+    mutable QMutex m_fileMutex;
+};
@@ -0,0 +1,821 @@
+#include "PageLayout.h"
+
+#include <Document/API/DocumentParser.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace
+{
+    constexpr std::size_t SectionAlignment = 8;
+
+    constexpr std::size_t alignUp(const std::size_t value)
+    {
+        return (value + SectionAlignment - 1) & ~(SectionAlignment - 1);
+    }
+}
+
+class PageLayout::Packer
+{
+public:
+    template<typename Container>
+    void add(const Section section, const Container& values)
+    {
+        using T = std::remove_cvref_t<decltype(*values.constData())>;
+        static_assert(std::is_trivially_copyable_v<T>);
+
+        m_sources[section] = { values.constData(), static_cast<std::size_t>(values.size()) * sizeof(T), static_cast<uint32_t>(values.size()) };
+    }
+
+    PageLayout pack(Header header) const
+    {
+        std::size_t size = alignUp(sizeof(Header));
+
+        for (uint32_t section = 0; section < SectionCount; ++section)
+        {
+            header.offsets[section] = static_cast<uint32_t>(size);
+            header.counts[section] = m_sources[section].count;
+            size = alignUp(size + m_sources[section].bytes);
+        }
+
+        // Zero-initialized, so paddings are deterministic
+        const std::shared_ptr<std::byte[]> storage(new std::byte[size]());
+
+        std::memcpy(storage.get(), &header, sizeof(Header));
+
+        for (uint32_t section = 0; section < SectionCount; ++section)
+        {
+            if (m_sources[section].bytes)
+                std::memcpy(storage.get() + header.offsets[section], m_sources[section].data, m_sources[section].bytes);
+        }
+
+        PageLayout layout;
+        layout.m_storage = storage;
+        layout.m_size = static_cast<qsizetype>(size);
+        return layout;
+    }
+
+private:
+    struct Source
+    {
+        const void* data = nullptr;
+        std::size_t bytes = 0;
+        uint32_t count = 0;
+    };
+
+    Source m_sources[SectionCount];
+};
+
+PageLayout PageLayout::build(const QList<QRectF>& charBoxes, const QString& text, const QList<DocumentLink>& links)
+{
+    Header header {};
+    Packer packer;
+
+    // Line forming method
+    QList<Box> lineBoxes;
+    QList<int32_t> lineStarts;
+    QList<CharRange> charRanges;
+    {
+        charRanges.reserve(charBoxes.size());
+
+        // TODO: change line detection method because right now it sometimes is wrong
+        const auto isOnLine = [](const QRectF& charRect, const QRectF& lineRect) -> bool
+        {
+            return charRect.top() <= lineRect.bottom() && charRect.bottom() >= lineRect.top();
+        };
+
+        QRectF currentLine;
+
+        for (int i = 0; i < charBoxes.size(); ++i)
+        {
+            const auto& box = charBoxes[i];
+
+            if (lineStarts.isEmpty())
+            {
+                currentLine = box;
+                lineStarts.append(i);
+            }
+            else if (isOnLine(currentLine, box))
+            {
+                currentLine |= box; // TODO: optimize calculations
+            }
+            else
+            {
+                lineBoxes.append(toBox(currentLine));
+
+                currentLine = box;
+                lineStarts.append(i);
+            }
+
+            charRanges.append({ static_cast<float>(box.left()), static_cast<float>(box.right()) });
+        }
+
+        if (!lineStarts.isEmpty())
+            lineBoxes.append(toBox(currentLine));
+
+        lineStarts.append(static_cast<int32_t>(charBoxes.size()));
+    }
+
+    packer.add(Text, text);
+
+    packer.add(LineBoxes, lineBoxes);
+    packer.add(LineStarts, lineStarts);
+    packer.add(CharRanges, charRanges);
+
+    // Word forming method: words are split by whitespace (if text is available) and by wide gaps
+    QList<CharRange> wordRanges;
+    QList<int32_t> wordStarts;
+    QList<int32_t> lineWordStarts;
+    {
+        const bool useText = text.size() == charBoxes.size();
+
+        for (qsizetype line = 0; line < lineBoxes.size(); ++line)
+        {
+            const Box& lineBox = lineBoxes[line];
+            const float maxGap = 0.25f * (lineBox.bottom - lineBox.top);
+
+            lineWordStarts.append(static_cast<int32_t>(wordStarts.size()));
+
+            bool inWord = false;
+
+            for (int32_t i = lineStarts[line]; i < lineStarts[line + 1]; ++i)
+            {
+                if (useText && text[i].isSpace())
+                {
+                    inWord = false;
+                    continue;
+                }
+
+                if (!inWord || charRanges[i].left - charRanges[i - 1].right > maxGap)
+                {
+                    wordStarts.append(i);
+                    wordRanges.append(charRanges[i]);
+                    inWord = true;
+                }
+                else
+                {
+                    wordRanges.back().right = std::max(wordRanges.back().right, charRanges[i].right);
+                }
+            }
+        }
+
+        lineWordStarts.append(static_cast<int32_t>(wordStarts.size()));
+        wordStarts.append(static_cast<int32_t>(charBoxes.size()));
+    }
+
+    packer.add(WordRanges, wordRanges);
+    packer.add(WordStarts, wordStarts);
+    packer.add(LineWordStarts, lineWordStarts);
+
+    // Block forming method: consecutive lines close vertically and overlapping horizontally
+    QList<Box> blockBoxes;
+    QList<int32_t> blockLineStarts;
+    {
+        const auto continuesBlock = [](const Box& block, const Box& previous, const Box& line) -> bool
+        {
+            const float height = std::max(previous.bottom - previous.top, line.bottom - line.top);
+            const float gap = line.top - previous.bottom;
+
+            return gap > -0.5f * height && gap < height && line.left < block.right && line.right > block.left;
+        };
+
+        for (qsizetype line = 0; line < lineBoxes.size(); ++line)
+        {
+            const Box& lineBox = lineBoxes[line];
+
+            if (blockBoxes.isEmpty() || !continuesBlock(blockBoxes.back(), lineBoxes[line - 1], lineBox))
+            {
+                blockLineStarts.append(static_cast<int32_t>(line));
+                blockBoxes.append(lineBox);
+            }
+            else
+            {
+                Box& block = blockBoxes.back();
+                block.left = std::min(block.left, lineBox.left);
+                block.top = std::min(block.top, lineBox.top);
+                block.right = std::max(block.right, lineBox.right);
+                block.bottom = std::max(block.bottom, lineBox.bottom);
+            }
+        }
+
+        blockLineStarts.append(static_cast<int32_t>(lineBoxes.size()));
+    }
+
+    packer.add(BlockBoxes, blockBoxes);
+    packer.add(BlockLineStarts, blockLineStarts);
+
+    // Link table
+    QList<LinkRecord> linkRecords;
+    QList<int32_t> linkRectStarts;
+    QList<Box> linkRects;
+    QList<int32_t> linkRectOwners;
+    QByteArray urlPool;
+    {
+        QRectF bounds;
+
+        for (qsizetype i = 0; i < links.size(); ++i)
+        {
+            const DocumentLink& link = links[i];
+            LinkRecord record {};
+
+            if (const auto url = std::get_if<DocumentLink::Url>(&link.contents()); url)
+            {
+                const QByteArray encoded = url->url().toEncoded();
+
+                record.kind = LinkRecord::Url;
+                record.urlBegin = static_cast<int32_t>(urlPool.size());
+                record.urlLength = static_cast<int32_t>(encoded.size());
+                urlPool.append(encoded);
+            }
+            else if (const auto jump = std::get_if<DocumentLink::Jump>(&link.contents()); jump)
+            {
+                record.kind = LinkRecord::Jump;
+                record.destinationPage = jump->destinationPage();
+                record.destinationZoom = jump->destinationZoom();
+                record.destinationX = static_cast<float>(jump->destinationLocation().x());
+                record.destinationY = static_cast<float>(jump->destinationLocation().y());
+            }
+
+            linkRecords.append(record);
+            linkRectStarts.append(static_cast<int32_t>(linkRects.size()));
+
+            for (const QRectF& rect : link.geometry())
+            {
+                linkRects.append(toBox(rect.normalized()));
+                linkRectOwners.append(static_cast<int32_t>(i));
+                bounds |= rect.normalized();
+            }
+        }
+
+        linkRectStarts.append(static_cast<int32_t>(linkRects.size()));
+
+        header.gridBounds = toBox(bounds);
+    }
+
+    packer.add(Links, linkRecords);
+    packer.add(LinkRectStarts, linkRectStarts);
+    packer.add(LinkRects, linkRects);
+    packer.add(LinkRectOwners, linkRectOwners);
+    packer.add(UrlPool, urlPool);
+
+    // Uniform grid over link rectangles: a point lookup checks only the rectangles of a single cell
+    QList<int32_t> gridCells;
+    QList<int32_t> gridEntries;
+    if (!linkRects.isEmpty())
+    {
+        const Box& bounds = header.gridBounds;
+
+        // Roughly one rectangle per cell
+        const int side = std::clamp(static_cast<int>(std::ceil(std::sqrt(linkRects.size()))), 1, 64);
+        header.gridColumns = side;
+        header.gridRows = side;
+        header.gridCellWidth = std::max((bounds.right - bounds.left) / side, std::numeric_limits<float>::epsilon());
+        header.gridCellHeight = std::max((bounds.bottom - bounds.top) / side, std::numeric_limits<float>::epsilon());
+
+        const auto column = [&](const float x) { return std::clamp(static_cast<int>((x - bounds.left) / header.gridCellWidth), 0, side - 1); };
+        const auto row = [&](const float y) { return std::clamp(static_cast<int>((y - bounds.top) / header.gridCellHeight), 0, side - 1); };
+
+        const auto forEachCell = [&](const Box& rect, auto&& fn)
+        {
+            for (int r = row(rect.top); r <= row(rect.bottom); ++r)
+                for (int c = column(rect.left); c <= column(rect.right); ++c)
+                    fn(r * side + c);
+        };
+
+        // Counting sort of rectangles into cells (CSR layout), keeps rectangles order inside a cell
+        gridCells.fill(0, side * side + 1);
+
+        for (const Box& rect : std::as_const(linkRects))
+            forEachCell(rect, [&](const int cell) { ++gridCells[cell + 1]; });
+
+        for (qsizetype cell = 1; cell < gridCells.size(); ++cell)
+            gridCells[cell] += gridCells[cell - 1];
+
+        gridEntries.resize(gridCells.back());
+        QList<int32_t> cursors = gridCells;
+
+        for (qsizetype rect = 0; rect < linkRects.size(); ++rect)
+            forEachCell(linkRects[rect], [&](const int cell) { gridEntries[cursors[cell]++] = static_cast<int32_t>(rect); });
+    }
+
+    packer.add(LinkGridCells, gridCells);
+    packer.add(LinkGridEntries, gridEntries);
+
+    return packer.pack(header);
+}
+
+std::optional<PageLayout> PageLayout::fromBytes(std::shared_ptr<const std::byte[]> storage, const qsizetype size)
+{
+    constexpr std::size_t elementSizes[SectionCount] = {
+        sizeof(Box), sizeof(int32_t), sizeof(CharRange),
+        sizeof(CharRange), sizeof(int32_t), sizeof(int32_t),
+        sizeof(Box), sizeof(int32_t),
+        sizeof(LinkRecord), sizeof(int32_t), sizeof(Box), sizeof(int32_t), sizeof(int32_t), sizeof(int32_t), sizeof(char),
+        sizeof(QChar),
+    };
+
+    if (!storage || size < static_cast<qsizetype>(sizeof(Header)) || reinterpret_cast<std::uintptr_t>(storage.get()) % SectionAlignment)
+        return std::nullopt;
+
+    Header header;
+    std::memcpy(&header, storage.get(), sizeof(Header));
+
+    // NOTE: only the bounds are checked, the contents are trusted to be written by build() (LayoutStore checks blocks' checksums)
+    for (uint32_t section = 0; section < SectionCount; ++section)
+    {
+        if (header.offsets[section] % SectionAlignment || header.offsets[section] + std::size_t(header.counts[section]) * elementSizes[section] > std::size_t(size))
+            return std::nullopt;
+    }
+
+    PageLayout layout;
+    layout.m_storage = std::move(storage);
+    layout.m_size = size;
+    return layout;
+}
+
+std::span<const std::byte> PageLayout::bytes() const
+{
+    return { m_storage.get(), static_cast<std::size_t>(m_size) };
+}
+
+qsizetype PageLayout::sizeInBytes() const
+{
+    return static_cast<qsizetype>(sizeof(PageLayout)) + m_size;
+}
+
+int PageLayout::lineCount() const
+{
+    return static_cast<int>(section<Box>(LineBoxes).size());
+}
+
+QRectF PageLayout::lineGeometry(const int line) const
+{
+    return toRect(section<Box>(LineBoxes)[line]);
+}
+
+CharIndices PageLayout::lineChars(const int line) const
+{
+    const auto starts = section<int32_t>(LineStarts);
+    return { starts[line], starts[line + 1] };
+}
+
+int PageLayout::charCount() const
+{
+    return static_cast<int>(section<CharRange>(CharRanges).size());
+}
+
+QStringView PageLayout::text(CharIndices chars) const
+{
+    const std::span<const QChar> text = section<QChar>(Text);
+
+    chars.first = std::clamp<int32_t>(chars.first, 0, static_cast<int32_t>(text.size()));
+    chars.second = std::clamp<int32_t>(chars.second, chars.first, static_cast<int32_t>(text.size()));
+
+    return QStringView(text.data() + chars.first, chars.second - chars.first);
+}
+
+int PageLayout::lineOfChar(const int index) const
+{
+    const auto starts = section<int32_t>(LineStarts);
+    const auto it = std::upper_bound(starts.begin(), starts.end(), index);
+    return static_cast<int>(std::distance(starts.begin(), it)) - 1;
+}
+
+LineIndices PageLayout::findLinesCrossedBy(const QRectF& rect) const
+{
+    const auto lines = section<Box>(LineBoxes);
+
+    auto first = std::partition_point(lines.begin(), lines.end(),
+        [&rect](const Box& line) {
+            return line.bottom < rect.top();
+        });
+
+    auto last = std::partition_point(first, lines.end(),
+        [&rect](const Box& line) {
+            return line.top <= rect.bottom();
+        });
+
+    if (first == lines.end() || last == lines.begin() || first >= last) {
+        return { -1, -1 };
+    }
+
+    --last;
+
+    while (first <= last && !toRect(*first).intersects(rect)) {
+        ++first;
+    }
+
+    if (first > last) {
+        return { -1, -1 };
+    }
+
+    while (last >= first && !toRect(*last).intersects(rect)) {
+        --last;
+    }
+
+    return {
+        static_cast<int32_t>(std::distance(lines.begin(), first)),
+        static_cast<int32_t>(std::distance(lines.begin(), last)),
+    };
+}
+
+int PageLayout::findLineAt(const QPointF point) const
+{
+    const auto lines = section<Box>(LineBoxes);
+
+    const auto lineIt = std::lower_bound(lines.begin(), lines.end(), point, [](const Box& line, const QPointF& p) -> bool {
+        return line.bottom < p.y();
+    });
+
+    if (lineIt == lines.end() || point.y() < lineIt->top)
+        return -1;
+
+    if (lineIt->left <= point.x() && point.x() <= lineIt->right)
+        return static_cast<int>(std::distance(lines.begin(), lineIt));
+
+    return -1;
+}
+
+int PageLayout::findFirstCharCrossedBy(const int line, const QRectF& rect) const
+{
+    const Box& geometry = section<Box>(LineBoxes)[line];
+    const auto [begin, end] = lineChars(line);
+
+    if (rect.bottom() < geometry.top || rect.top() > geometry.bottom)
+        return end;
+
+    const auto chars = section<CharRange>(CharRanges).subspan(begin, end - begin);
+
+    const auto it = std::lower_bound(chars.begin(), chars.end(), rect.left(),
+        [](const CharRange& range, const qreal left) {
+            return charCenter(range) < left;
+        });
+
+    if (it != chars.end() && charCenter(*it) <= rect.right())
+        return begin + static_cast<int>(std::distance(chars.begin(), it));
+
+    return end;
+}
+
+int PageLayout::findLastCharCrossedBy(const int line, const QRectF& rect) const
+{
+    const Box& geometry = section<Box>(LineBoxes)[line];
+    const auto [begin, end] = lineChars(line);
+
+    if (rect.bottom() < geometry.top || rect.top() > geometry.bottom)
+        return end;
+
+    const auto chars = section<CharRange>(CharRanges).subspan(begin, end - begin);
+
+    auto it = std::upper_bound(chars.begin(), chars.end(), rect.right(),
+        [](const qreal right, const CharRange& range) {
+            return right < charCenter(range);
+        });
+
+    if (it != chars.begin())
+    {
+        --it;
+        if (charCenter(*it) >= rect.left())
+            return begin + static_cast<int>(std::distance(chars.begin(), it));
+    }
+
+    return end;
+}
+
+QRectF PageLayout::lineGeometryByIndices(const int line, int begin, int end) const
+{
+    const auto [lineBegin, lineEnd] = lineChars(line);
+
+    if (begin >= lineEnd || begin >= end)
+        return {};
+
+    begin = std::max(lineBegin, begin);
+    end = std::min(lineEnd, end);
+
+    if (begin >= end)
+        return {};
+
+    const auto chars = section<CharRange>(CharRanges);
+    const Box& geometry = section<Box>(LineBoxes)[line];
+
+    const float left = chars[begin].left;
+    const float right = (end == lineEnd)
+        ? geometry.right
+        : chars[end].left;
+
+    return toRect({ left, geometry.top, right, geometry.bottom });
+}
+
+WordIndices PageLayout::lineWords(const int line) const
+{
+    const auto starts = section<int32_t>(LineWordStarts);
+    return { starts[line], starts[line + 1] };
+}
+
+CharIndices PageLayout::wordChars(const int word) const
+{
+    const auto starts = section<int32_t>(WordStarts);
+    return { starts[word], starts[word + 1] };
+}
+
+int PageLayout::findWordAt(const int line, const qreal x) const
+{
+    const auto [begin, end] = lineWords(line);
+    const auto words = section<CharRange>(WordRanges).subspan(begin, end - begin);
+
+    const auto it = std::lower_bound(words.begin(), words.end(), x,
+        [](const CharRange& range, const qreal x) {
+            return range.right < x;
+        });
+
+    if (it != words.end() && it->left <= x)
+        return begin + static_cast<int>(std::distance(words.begin(), it));
+
+    return -1;
+}
+
+int PageLayout::findFirstWordCrossedBy(const int line, const QRectF& rect) const
+{
+    const Box& geometry = section<Box>(LineBoxes)[line];
+
+    if (rect.bottom() < geometry.top || rect.top() > geometry.bottom)
+        return -1;
+
+    const auto [begin, end] = lineWords(line);
+    const auto words = section<CharRange>(WordRanges).subspan(begin, end - begin);
+
+    const auto it = std::lower_bound(words.begin(), words.end(), rect.left(),
+        [](const CharRange& range, const qreal left) {
+            return range.right < left;
+        });
+
+    if (it != words.end() && it->left <= rect.right())
+        return begin + static_cast<int>(std::distance(words.begin(), it));
+
+    return -1;
+}
+
+int PageLayout::findLastWordCrossedBy(const int line, const QRectF& rect) const
+{
+    const Box& geometry = section<Box>(LineBoxes)[line];
+
+    if (rect.bottom() < geometry.top || rect.top() > geometry.bottom)
+        return -1;
+
+    const auto [begin, end] = lineWords(line);
+    const auto words = section<CharRange>(WordRanges).subspan(begin, end - begin);
+
+    auto it = std::upper_bound(words.begin(), words.end(), rect.right(),
+        [](const qreal right, const CharRange& range) {
+            return right < range.left;
+        });
+
+    if (it != words.begin())
+    {
+        --it;
+        if (it->right >= rect.left())
+            return begin + static_cast<int>(std::distance(words.begin(), it));
+    }
+
+    return -1;
+}
+
+int PageLayout::blockCount() const
+{
+    return static_cast<int>(section<Box>(BlockBoxes).size());
+}
+
+LineIndices PageLayout::blockLines(const int block) const
+{
+    const auto starts = section<int32_t>(BlockLineStarts);
+    return { starts[block], starts[block + 1] - 1 };
+}
+
+int PageLayout::blockOfLine(const int line) const
+{
+    const auto starts = section<int32_t>(BlockLineStarts);
+    const auto it = std::upper_bound(starts.begin(), starts.end(), line);
+    return static_cast<int>(std::distance(starts.begin(), it)) - 1;
+}
+
+int PageLayout::findBlockAt(const QPointF point) const
+{
+    // NOTE: there are few blocks on a page, so the linear scan is cheap enough
+    const auto blocks = section<Box>(BlockBoxes);
+
+    for (std::size_t block = 0; block < blocks.size(); ++block)
+    {
+        if (toRect(blocks[block]).contains(point))
+            return static_cast<int>(block);
+    }
+
+    return -1;
+}
+
+bool PageLayout::hitTest(const QPointF point, const uint8_t lod) const
+{
+    if (lod <= DocumentTextLoD::Block)
+        return findBlockAt(point) != -1;
+
+    const int line = findLineAt(point);
+
+    if (line == -1 || lod == DocumentTextLoD::Line)
+        return line != -1;
+
+    if (lod == DocumentTextLoD::Word)
+        return findWordAt(line, point.x()) != -1;
+
+    return findCharAt(line, point.x()) != -1;
+}
+
+std::pair<LineIndices, CharIndices> PageLayout::findRegion(const QRectF& rect, const uint8_t lod) const
+{
+    LineIndices lines = findLinesCrossedBy(rect.normalized());
+
+    if (lines.first == -1)
+        return {{ -1, -1 }, { -1, -1 }};
+
+    if (lod <= DocumentTextLoD::Block)
+        lines = { blockLines(blockOfLine(lines.first)).first, blockLines(blockOfLine(lines.second)).second };
+
+    if (lod <= DocumentTextLoD::Line)
+        return { lines, { lineChars(lines.first).first, lineChars(lines.second).second } };
+
+    if (lod == DocumentTextLoD::Word)
+    {
+        const int firstWord = findFirstWordCrossedBy(lines.first, rect);
+        const int lastWord = findLastWordCrossedBy(lines.second, rect);
+
+        return {
+            lines,
+            {
+                firstWord != -1 ? wordChars(firstWord).first : lineChars(lines.first).second,
+                lastWord != -1 ? wordChars(lastWord).second : lineChars(lines.second).second + 1,
+            }
+        };
+    }
+
+    return {
+        lines,
+        {
+            findFirstCharCrossedBy(lines.first, rect),
+            findLastCharCrossedBy(lines.second, rect) + 1,
+        }
+    };
+}
+
+CharIndices PageLayout::findUnitAt(const QPointF point, const uint8_t lod) const
+{
+    const auto lines = section<Box>(LineBoxes);
+
+    const auto lineIt = std::lower_bound(lines.begin(), lines.end(), point, [](const Box& line, const QPointF& p) -> bool {
+        return line.bottom < p.y();
+    });
+
+    if (lineIt == lines.end())
+        return { charCount(), charCount() };
+
+    const int line = static_cast<int>(std::distance(lines.begin(), lineIt));
+    const auto [lineBegin, lineEnd] = lineChars(line);
+
+    // Between lines
+    if (point.y() < lineIt->top)
+        return { lineBegin, lineBegin };
+
+    if (lod <= DocumentTextLoD::Block)
+    {
+        const auto [firstLine, lastLine] = blockLines(blockOfLine(line));
+        return { lineChars(firstLine).first, lineChars(lastLine).second };
+    }
+
+    if (lod == DocumentTextLoD::Line)
+        return { lineBegin, lineEnd };
+
+    if (lod == DocumentTextLoD::Word)
+    {
+        if (const int word = findWordAt(line, point.x()); word != -1)
+            return wordChars(word);
+    }
+
+    const auto chars = section<CharRange>(CharRanges).subspan(lineBegin, lineEnd - lineBegin);
+
+    const auto it = std::upper_bound(chars.begin(), chars.end(), point.x(),
+        [](const qreal x, const CharRange& range) {
+            return x < charCenter(range);
+        });
+
+    const int boundary = lineBegin + static_cast<int>(std::distance(chars.begin(), it));
+    return { boundary, boundary };
+}
+
+int PageLayout::linkCount() const
+{
+    return static_cast<int>(section<LinkRecord>(Links).size());
+}
+
+int PageLayout::findLink(const QPointF point) const
+{
+    const auto rects = section<Box>(LinkRects);
+
+    if (rects.empty())
+        return -1;
+
+    const Header& h = header();
+
+    if (!toRect(h.gridBounds).contains(point))
+        return -1;
+
+    const auto cells = section<int32_t>(LinkGridCells);
+    const auto entries = section<int32_t>(LinkGridEntries);
+    const auto owners = section<int32_t>(LinkRectOwners);
+
+    const int cell = gridRow(static_cast<float>(point.y())) * h.gridColumns + gridColumn(static_cast<float>(point.x()));
+
+    for (int32_t i = cells[cell]; i < cells[cell + 1]; ++i)
+    {
+        if (const int32_t rect = entries[i]; toRect(rects[rect]).contains(point))
+            return owners[rect];
+    }
+
+    return -1;
+}
+
+DocumentLink PageLayout::link(const int page, const int index) const
+{
+    const LinkRecord& record = section<LinkRecord>(Links)[index];
+    const auto starts = section<int32_t>(LinkRectStarts);
+    const auto rects = section<Box>(LinkRects).subspan(starts[index], starts[index + 1] - starts[index]);
+
+    QList<QRectF> geometry;
+    geometry.reserve(static_cast<qsizetype>(rects.size()));
+
+    for (const Box& rect : rects)
+        geometry.append(toRect(rect));
+
+    if (record.kind == LinkRecord::Url)
+    {
+        const auto pool = section<char>(UrlPool);
+        const QByteArray encoded(pool.data() + record.urlBegin, record.urlLength);
+        return { page, geometry, DocumentLink::Url(QUrl::fromEncoded(encoded)) };
+    }
+
+    return {
+        page,
+        geometry,
+        DocumentLink::Jump(record.destinationPage, record.destinationZoom, { record.destinationX, record.destinationY })
+    };
+}
+
+int PageLayout::findCharAt(const int line, const qreal x) const
+{
+    const auto [begin, end] = lineChars(line);
+    const auto chars = section<CharRange>(CharRanges).subspan(begin, end - begin);
+
+    const auto it = std::lower_bound(chars.begin(), chars.end(), x,
+        [](const CharRange& range, const qreal x) {
+            return range.right < x;
+        });
+
+    if (it != chars.end() && it->left <= x)
+        return begin + static_cast<int>(std::distance(chars.begin(), it));
+
+    return -1;
+}
+
+const PageLayout::Header& PageLayout::header() const
+{
+    return *reinterpret_cast<const Header*>(m_storage.get());
+}
+
+int PageLayout::gridColumn(const float x) const
+{
+    const Header& h = header();
+    return std::clamp(static_cast<int>((x - h.gridBounds.left) / h.gridCellWidth), 0, h.gridColumns - 1);
+}
+
+int PageLayout::gridRow(const float y) const
+{
+    const Header& h = header();
+    return std::clamp(static_cast<int>((y - h.gridBounds.top) / h.gridCellHeight), 0, h.gridRows - 1);
+}
+
+QRectF PageLayout::toRect(const Box& box)
+{
+    return QRectF(QPointF(box.left, box.top), QPointF(box.right, box.bottom));
+}
+
+PageLayout::Box PageLayout::toBox(const QRectF& rect)
+{
+    return {
+        static_cast<float>(rect.left()),
+        static_cast<float>(rect.top()),
+        static_cast<float>(rect.right()),
+        static_cast<float>(rect.bottom()),
+    };
+}
+
+float PageLayout::charCenter(const CharRange& range)
+{
+    return (range.left + range.right) / 2.0f;
+}
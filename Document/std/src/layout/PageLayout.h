@@ -0,0 +1,172 @@
+#pragma once
+
+#include <memory>
+#include <optional>
+#include <span>
+
+#include <QRectF>
+#include <QStringView>
+
+#include <Document/API/DocumentLink.h>
+
+using LineIndices = std::pair<int32_t, int32_t>; // [a; b]
+using CharIndices = std::pair<int32_t, int32_t>; // [a; b)
+using WordIndices = std::pair<int32_t, int32_t>; // [a; b)
+
+// Text and links layout of a single page.
+//
+// All the data lives in one contiguous block of plain arrays (structure-of-arrays), so the layout
+// is built with a single allocation and its size in bytes is known exactly.
+//
+// Text is indexed hierarchically: blocks -> lines -> words -> characters. Queries take a level of
+// detail (DocumentTextLoD) and descend no deeper than it.
+class PageLayout
+{
+public:
+    // Bumped whenever the block format changes
+    static constexpr uint32_t FormatVersion = 1;
+
+    PageLayout() = default;
+
+    // NOTE: text is used for word segmentation only if it matches char boxes one to one
+    [[nodiscard]] static PageLayout build(const QList<QRectF>& charBoxes, const QString& text, const QList<DocumentLink>& links);
+
+    // Layout over an existing block (e.g. a mapped file) without copying, nullopt if the block is malformed
+    [[nodiscard]] static std::optional<PageLayout> fromBytes(std::shared_ptr<const std::byte[]> storage, qsizetype size);
+    [[nodiscard]] std::span<const std::byte> bytes() const;
+
+    [[nodiscard]] qsizetype sizeInBytes() const;
+
+    // Lines
+    [[nodiscard]] int lineCount() const;
+    [[nodiscard]] QRectF lineGeometry(int line) const;
+    [[nodiscard]] CharIndices lineChars(int line) const;
+
+    [[nodiscard]] LineIndices findLinesCrossedBy(const QRectF& rect) const; // { -1, -1 } if none
+    [[nodiscard]] int findLineAt(QPointF point) const; // -1 if none
+
+    // Characters (indices are page-wide, the end of the line's range means "not found")
+    [[nodiscard]] int charCount() const;
+    [[nodiscard]] QStringView text(CharIndices chars) const; // clipped to the page text
+    [[nodiscard]] int lineOfChar(int index) const;
+
+    [[nodiscard]] int findFirstCharCrossedBy(int line, const QRectF& rect) const;
+    [[nodiscard]] int findLastCharCrossedBy(int line, const QRectF& rect) const;
+
+    [[nodiscard]] QRectF lineGeometryByIndices(int line, int begin, int end) const;
+
+    // Words
+    [[nodiscard]] WordIndices lineWords(int line) const;
+    [[nodiscard]] CharIndices wordChars(int word) const;
+
+    [[nodiscard]] int findWordAt(int line, qreal x) const; // -1 if none
+    [[nodiscard]] int findFirstWordCrossedBy(int line, const QRectF& rect) const; // -1 if none
+    [[nodiscard]] int findLastWordCrossedBy(int line, const QRectF& rect) const; // -1 if none
+
+    // Blocks (paragraphs, column pieces)
+    [[nodiscard]] int blockCount() const;
+    [[nodiscard]] LineIndices blockLines(int block) const;
+    [[nodiscard]] int blockOfLine(int line) const;
+    [[nodiscard]] int findBlockAt(QPointF point) const; // -1 if none
+
+    // Level-of-detail aware queries
+    [[nodiscard]] bool hitTest(QPointF point, uint8_t lod) const;
+    [[nodiscard]] std::pair<LineIndices, CharIndices> findRegion(const QRectF& rect, uint8_t lod) const; // { -1, -1 } if none
+
+    // Text unit (block, line, word) under the point or the empty range at the nearest char boundary
+    [[nodiscard]] CharIndices findUnitAt(QPointF point, uint8_t lod) const;
+
+    // Links
+    [[nodiscard]] int linkCount() const;
+    [[nodiscard]] int findLink(QPointF point) const; // -1 if none
+    [[nodiscard]] DocumentLink link(int page, int index) const;
+
+private:
+    struct Box
+    {
+        float left, top, right, bottom;
+    };
+
+    struct CharRange
+    {
+        float left, right;
+    };
+
+    struct LinkRecord
+    {
+        enum Kind : int32_t { Url, Jump };
+
+        int32_t kind;
+        int32_t destinationPage;
+        float destinationZoom;
+        float destinationX;
+        float destinationY;
+        int32_t urlBegin;
+        int32_t urlLength;
+    };
+
+    enum Section : uint32_t
+    {
+        LineBoxes,      // Box[lines]
+        LineStarts,     // int32_t[lines + 1], first char of each line
+        CharRanges,     // CharRange[chars]
+
+        WordRanges,     // CharRange[words]
+        WordStarts,     // int32_t[words + 1], first char of each word
+        LineWordStarts, // int32_t[lines + 1], first word of each line
+
+        BlockBoxes,     // Box[blocks]
+        BlockLineStarts,// int32_t[blocks + 1], first line of each block
+
+        Links,          // LinkRecord[links]
+        LinkRectStarts, // int32_t[links + 1], first rect of each link
+        LinkRects,      // Box[rects]
+        LinkRectOwners, // int32_t[rects], link of each rect
+        LinkGridCells,  // int32_t[cells + 1], range of each cell in LinkGridEntries
+        LinkGridEntries,// int32_t[entries], rect indices
+        UrlPool,        // char[], encoded URLs
+
+        Text,           // QChar[], page text
+
+        SectionCount
+    };
+
+    struct Header
+    {
+        uint32_t offsets[SectionCount];
+        uint32_t counts[SectionCount];
+
+        // Uniform grid over link rectangles
+        Box gridBounds;
+        int32_t gridColumns;
+        int32_t gridRows;
+        float gridCellWidth;
+        float gridCellHeight;
+    };
+
+    class Packer;
+
+    [[nodiscard]] const Header& header() const;
+
+    template<typename T>
+    [[nodiscard]] std::span<const T> section(Section section) const
+    {
+        if (!m_storage)
+            return {};
+
+        const Header& h = header();
+        return { reinterpret_cast<const T*>(m_storage.get() + h.offsets[section]), h.counts[section] };
+    }
+
+    [[nodiscard]] int findCharAt(int line, qreal x) const; // -1 if none
+
+    [[nodiscard]] int gridColumn(float x) const;
+    [[nodiscard]] int gridRow(float y) const;
+
+    static QRectF toRect(const Box& box);
+    static Box toBox(const QRectF& rect);
+    static float charCenter(const CharRange& range);
+
+    std::shared_ptr<const std::byte[]> m_storage;
+    qsizetype m_size = 0;
+};
@@ -0,0 +1,163 @@
+#include "RenderScheduler.h"
+
+#include <algorithm>
+
+void RenderScheduler::setConcurrency(const int renders)
+{
+    m_concurrency = std::max(1, renders);
+    dispatch();
+}
+
+void RenderScheduler::setMemoryLimit(const qsizetype bytes)
+{
+    m_memoryLimit = bytes;
+    reclaim();
+}
+
+void RenderScheduler::setActive(const StandardDocumentRenderer* owner)
+{
+    m_active = owner;
+
+    const auto it = std::ranges::find(m_clients, owner, &Client::Owner);
+
+    if (it != m_clients.end())
+    {
+        const Client client = *it;
+        m_clients.erase(it);
+        m_clients.append(client);
+    }
+
+    dispatch();
+}
+
+void RenderScheduler::attach(const StandardDocumentRenderer* owner, RenderSchedulerClient* client)
+{
+    // New documents are considered the least recently used ones until activated
+    m_clients.prepend({ owner, client });
+    dispatch();
+}
+
+void RenderScheduler::detach(const RenderSchedulerClient* client)
+{
+    const auto it = std::ranges::find(m_clients, client, &Client::Handle);
+
+    if (it == m_clients.end())
+        return;
+
+    m_running -= it->Running;
+    m_clients.erase(it);
+
+    dispatch();
+}
+
+void RenderScheduler::wake()
+{
+    dispatch();
+}
+
+void RenderScheduler::release(const RenderSchedulerClient* client)
+{
+    if (Client* entry = find(client); entry && entry->Running > 0)
+    {
+        --entry->Running;
+        --m_running;
+    }
+}
+
+void RenderScheduler::reclaim()
+{
+    qsizetype total = 0;
+
+    for (const Client& client : std::as_const(m_clients))
+        total += client.Handle->cacheCost();
+
+    qsizetype excess = total - m_memoryLimit;
+
+    if (m_memoryLimit <= 0 || excess <= 0)
+        return;
+
+    const auto trim = [&excess](const Client& client)
+    {
+        const qsizetype cost = client.Handle->cacheCost();
+        client.Handle->trimCache(std::max<qsizetype>(0, cost - excess));
+        excess -= cost - client.Handle->cacheCost();
+    };
+
+    // Background documents give their memory up first, the least recently active ones before others
+    for (const Client& client : std::as_const(m_clients))
+    {
+        if (excess <= 0)
+            return;
+
+        if (client.Owner != m_active)
+            trim(client);
+    }
+
+    if (const auto it = std::ranges::find(m_clients, m_active, &Client::Owner); excess > 0 && it != m_clients.end())
+        trim(*it);
+}
+
+void RenderScheduler::dispatch()
+{
+    // Clients start their work synchronously and might wake the scheduler up again
+    if (m_dispatching)
+        return;
+
+    m_dispatching = true;
+
+    QList<const RenderSchedulerClient*> skipped;
+
+    while (m_running < m_concurrency)
+    {
+        Client* client = pick(skipped);
+
+        if (!client)
+            break;
+
+        if (client->Handle->startWork())
+        {
+            ++client->Running;
+            ++m_running;
+        }
+        else
+        {
+            skipped.append(client->Handle);
+        }
+    }
+
+    m_dispatching = false;
+}
+
+RenderScheduler::Client* RenderScheduler::pick(const QList<const RenderSchedulerClient*>& skipped)
+{
+    const auto isReady = [&skipped](const Client& client)
+    {
+        return !skipped.contains(client.Handle) && client.Handle->hasWork();
+    };
+
+    const auto active = std::ranges::find(m_clients, m_active, &Client::Owner);
+
+    if (active != m_clients.end() && isReady(*active))
+        return &*active;
+
+    const bool isActiveBusy = active != m_clients.end() && active->Handle->hasUrgentWork();
+
+    for (qsizetype i = 0; i < m_clients.size(); ++i)
+    {
+        const qsizetype index = (m_next + i) % m_clients.size();
+
+        if (isReady(m_clients[index]) && (!isActiveBusy || m_clients[index].Handle->hasUrgentWork()))
+        {
+            m_next = index + 1;
+            return &m_clients[index];
+        }
+    }
+
+    return nullptr;
+}
+
+RenderScheduler::Client* RenderScheduler::find(const RenderSchedulerClient* client)
+{
+    const auto it = std::ranges::find(m_clients, client, &Client::Handle);
+    return it != m_clients.end() ? &*it : nullptr;
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <QList>
+
+class StandardDocumentRenderer;
+
+// Renderer as seen by the scheduler. A client renders at most one image per granted slot.
+struct RenderSchedulerClient
+{
+    virtual ~RenderSchedulerClient() = default;
+
+    [[nodiscard]] virtual bool hasWork() const = 0;
+
+    // Images somebody waits for (queued or being rendered), as opposed to background work like thumbnails
+    [[nodiscard]] virtual bool hasUrgentWork() const = 0;
+
+    // Returns true if a render was started, its slot must be released once it is finished or canceled
+    virtual bool startWork() = 0;
+
+    [[nodiscard]] virtual qsizetype cacheCost() const = 0;
+    virtual void trimCache(qsizetype bytes) = 0;
+};
+
+// Render slots and cache memory shared by the renderers of all open documents.
+//
+// Slots go to the active renderer first and to the rest in turn, but only to their urgent work while the active
+// renderer has urgent work itself, so that background passes do not compete with it. Memory over the limit is taken
+// from the renderers that were active least recently, the active one is trimmed last.
+class RenderScheduler
+{
+public:
+    void setConcurrency(int renders);
+    void setMemoryLimit(qsizetype bytes);
+    void setActive(const StandardDocumentRenderer* owner);
+
+    void attach(const StandardDocumentRenderer* owner, RenderSchedulerClient* client);
+    void detach(const RenderSchedulerClient* client);
+
+    void wake();                                  // the client got work or freed its slot
+    void release(const RenderSchedulerClient* client);
+    void reclaim();                               // the client's cache grew
+
+private:
+    struct Client
+    {
+        const StandardDocumentRenderer* Owner;
+        RenderSchedulerClient* Handle;
+        int Running = 0;
+    };
+
+    void dispatch();
+    [[nodiscard]] Client* pick(const QList<const RenderSchedulerClient*>& skipped);
+    [[nodiscard]] Client* find(const RenderSchedulerClient* client);
+
+    QList<Client> m_clients; // ordered by the last activation, the most recent one is the last
+    const StandardDocumentRenderer* m_active = nullptr;
+    qsizetype m_next = 0;    // round robin position
+
+    int m_concurrency = 2;
+    int m_running = 0;
+    bool m_dispatching = false;
+
+    qsizetype m_memoryLimit = 0;
+};
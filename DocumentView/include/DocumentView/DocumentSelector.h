@@ -2,8 +2,10 @@
 
 #include <QObject>
 #include <QPoint>
+#include <QElapsedTimer>
 
 class DocumentView;
+class DocumentPageItem;
 
 class DocumentSelector : public QObject
 {
@@ -15,10 +17,17 @@ protected:
 
 private:
     void onPressed(QPoint);
+    void onDoubleClicked(QPoint);
     void onReleased(QPoint);
     void onMoved(QPoint) const;
 
+    void anchor(QPointF scenePos, uint8_t lod) const;
+    DocumentPageItem* pageAt(QPointF scenePos) const;
+
     DocumentView* const m_view;
 
     std::optional<QPointF> m_start;
+
+    // Triple click is a press shortly after a double click
+    QElapsedTimer m_doubleClickTimer;
 };
@@ -2,6 +2,8 @@
 
 #include <QGraphicsView>
 
+#include <Document/API/DocumentParser.h>
+
 class DocumentFacade;
 
 // TODO: hide QGraphicsView
@@ -13,16 +15,31 @@ public:
 
     void setDocument(const std::shared_ptr<DocumentFacade>& document);
 
+    // Memory for display format copies of page images, 256 MiB by default
+    void setPixmapCacheLimit(qsizetype bytes);
+    qsizetype pixmapCacheLimit() const;
+
+    // Lays out pages starting from the given one again after their sizes got known
+    void updatePageGeometry(int fromPage);
+
     using QGraphicsView::transformationAnchor;
     using QGraphicsView::setTransformationAnchor;
 
     QString getSelectedText() const;
 
+    DocumentTextSelection* selection() const;
+    void updateSelection(const DocumentDirtyRegion& region) const;
+
+    // Pages are stacked vertically, so both lookups are binary searches over their scene rectangles
+    QList<int> pagesIn(const QRectF& sceneRect) const;
+    int pageAt(QPointF scenePos) const; // vertically nearest, -1 if there are no pages
+
     // TODO: remove it
     QGraphicsItem* page(int) const;
 
 private:
     friend struct RenderFeedback;
+    friend struct ParserFeedback;
     friend struct PageItemFeedback;
 
     struct Private;
@@ -3,18 +3,24 @@
 #include <QPainter>
 #include <QGraphicsSceneHoverEvent>
 #include <QCursor>
+#include <QStyleOptionGraphicsItem>
 
 #include <Document/API/DocumentFacade.h>
 #include <Document/API/DocumentParser.h>
+#include <Document/API/DocumentRenderer.h>
+
+#include "PagePixmapCache.h"
 
 struct DocumentPageItem::Private
 {
     friend class DocumentPageItem;
 
-    Private(const std::shared_ptr<DocumentFacade>& document, Feedback* feedback, const int number)
+    Private(const std::shared_ptr<DocumentFacade>& document, Feedback* feedback, DocumentRenderFeedback* renderFeedback, PagePixmapCache* pixmaps, const DocumentTextSelection* selection, const int number)
         : document(document)
         , feedback(feedback)
-        , textRegion(document->textRegion())
+        , renderFeedback(renderFeedback)
+        , pixmaps(pixmaps)
+        , selection(selection)
         , number(number)
         , pointSize(document->pageSize(number))
     {}
@@ -22,19 +28,25 @@ struct DocumentPageItem::Private
 private:
     std::shared_ptr<DocumentFacade> const document;
     Feedback* const feedback;
-    const std::unique_ptr<DocumentTextRegion> textRegion;
+    DocumentRenderFeedback* const renderFeedback;
+    PagePixmapCache* const pixmaps;
+    const DocumentTextSelection* const selection;
 
     const int number;
-    const QSizeF pointSize;
+    QSizeF pointSize;
+
+    // Links are told apart by id, the geometry is taken only when the hovered link changes
+    int32_t currentLink = -1;
+    QList<QRectF> currentLinkGeometry;
 
-    QRectF selectionRect;
-    std::optional<DocumentLink> currentLink;
+    qreal paintScale = 1.0;
 };
 
-DocumentPageItem::DocumentPageItem(const std::shared_ptr<DocumentFacade>& document, Feedback* feedback, const int number)
-    : d_ptr(new Private(document, feedback, number))
+DocumentPageItem::DocumentPageItem(const std::shared_ptr<DocumentFacade>& document, Feedback* feedback, DocumentRenderFeedback* renderFeedback, PagePixmapCache* pixmaps, const DocumentTextSelection* selection, const int number)
+    : d_ptr(new Private(document, feedback, renderFeedback, pixmaps, selection, number))
 {
     setCacheMode(NoCache);
+    setFlag(ItemUsesExtendedStyleOption, true);
     setAcceptHoverEvents(true);
     setFlag(ItemIsSelectable, true);
     assert(number >= 0 && number < _provider->document()->pageCount());
@@ -49,63 +61,121 @@ QRectF DocumentPageItem::boundingRect() const
 
 void DocumentPageItem::paint(QPainter* painter, const QStyleOptionGraphicsItem* option, QWidget* widget)
 {
-    Q_UNUSED(option);
+    // Only the exposed part is drawn, scrolling exposes just a strip of the page
+    const QRectF exposed = option->exposedRect & boundingRect();
+
+    if (exposed.isEmpty())
+        return;
 
     const qreal scale = painter->worldTransform().m11();
+    d_ptr->paintScale = scale;
+
+    // Page is visible, so its text layout (and neighbours' ones) will be needed soon
+    d_ptr->document->prefetchLayout(d_ptr->number);
 
     // TODO: draw as underlay after other operations to exclude possible composition interference (~~~)
-    painter->fillRect(boundingRect(), Qt::white);
+    painter->fillRect(exposed, Qt::white);
+
+    // Pixel ratio of the screen the view is on right now
+    const qreal pixelRatio = painter->device()->devicePixelRatioF();
 
-    if (const auto image = d_ptr->document->requestImage(d_ptr->number, scale); image)
-        painter->drawImage(boundingRect(), *image);
+    if (const auto image = d_ptr->document->requestImage(d_ptr->number, scale, pixelRatio, d_ptr->renderFeedback); image)
+        drawImage(painter, *image, exposed);
 
     painter->save();
     painter->setCompositionMode(QPainter::CompositionMode_Multiply);
 
-    if (const QRectF rect = d_ptr->selectionRect; !rect.isNull())
+    if (const QList<QRectF> geometries = d_ptr->selection->geometry(d_ptr->number); !geometries.isEmpty())
     {
         // TODO: make text selection style configurable
 
         painter->setPen(Qt::NoPen);
         painter->setBrush(QColor(206, 235, 249, 200));
 
-        for (const QList<QRectF> geometries = d_ptr->textRegion->geometry(); const QRectF& geometry : geometries)
-            painter->drawRect(geometry.adjusted(-0, -2, +0, +2));
+        for (const QRectF& geometry : geometries)
+        {
+            if (const QRectF rect = geometry.adjusted(-0, -2, +0, +2); rect.intersects(exposed))
+                painter->drawRect(rect);
+        }
     }
 
-    if (d_ptr->currentLink)
+    if (d_ptr->currentLink != -1)
     {
         // TODO: make link highlighting style configurable
 
         painter->setPen(Qt::NoPen);
         painter->setBrush(QColor(255, 255, 204, 160));
 
-        for (const QRectF rect : d_ptr->currentLink->geometry())
-            painter->drawRect(rect.adjusted(-0, -2, +0, +2));
+        for (const QRectF& geometry : d_ptr->currentLinkGeometry)
+        {
+            if (const QRectF rect = geometry.adjusted(-0, -2, +0, +2); rect.intersects(exposed))
+                painter->drawRect(rect);
+        }
     }
 
     painter->restore();
 }
 
-void DocumentPageItem::SetSelectionRect(const QRectF& rect)
+void DocumentPageItem::drawImage(QPainter* painter, const QImage& image, const QRectF& exposed) const
 {
-    if (rect != d_ptr->selectionRect)
-    {
-        d_ptr->selectionRect = rect;
+    const QTransform transform = painter->worldTransform();
+    const qreal pixelRatio = painter->device()->devicePixelRatioF();
 
-        const auto idTmp = d_ptr->textRegion->id();
-        d_ptr->textRegion->configure(d_ptr->number, rect);
+    // Image rendered exactly for the current device scale is blitted as is, without resampling
+    const bool isExact = transform.type() <= QTransform::TxScale
+        && transform.m11() > 0 && qFuzzyCompare(transform.m11(), transform.m22())
+        && image.size() == (d_ptr->pointSize * transform.m11() * pixelRatio).toSize();
 
-        if (idTmp != d_ptr->textRegion->id())
-        {
-            update();
-        }
+    if (!isExact)
+    {
+        const qreal imageScale = image.width() / d_ptr->pointSize.width();
+        const QRectF source(exposed.topLeft() * imageScale, exposed.size() * imageScale);
+
+        painter->drawImage(exposed, image, source);
+        return;
     }
+
+    // An image still being composed changes with every part drawn, its copies would only crowd the cache out
+    const QPixmap pixmap = image.text(DocumentRenderer::PartialImageKey).isEmpty()
+        ? d_ptr->pixmaps->pixmap(image, pixelRatio)
+        : PagePixmapCache::convert(image, pixelRatio);
+
+    // Top left corner snapped to the device pixel grid
+    const QPointF origin = transform.map(QPointF(0, 0));
+    const QPointF aligned(std::round(origin.x() * pixelRatio) / pixelRatio, std::round(origin.y() * pixelRatio) / pixelRatio);
+
+    // Exposed part in image pixels
+    const qreal deviceScale = transform.m11() * pixelRatio;
+    const QRect source = QRectF(exposed.topLeft() * deviceScale, exposed.size() * deviceScale).toAlignedRect() & pixmap.rect();
+
+    painter->save();
+    painter->resetTransform();
+    painter->drawPixmap(aligned + QPointF(source.topLeft()) / pixelRatio, pixmap, source);
+    painter->restore();
 }
 
-QString DocumentPageItem::GetSelectedText() const
+void DocumentPageItem::UpdateSelection(const QRectF& rect)
 {
-    return d_ptr->textRegion->text();
+    if (rect.isNull())
+        update();
+    else
+        update(rect.adjusted(-0, -2, +0, +2));
+}
+
+void DocumentPageItem::UpdateGeometry()
+{
+    const QSizeF pointSize = d_ptr->document->pageSize(d_ptr->number);
+
+    if (pointSize == d_ptr->pointSize)
+        return;
+
+    prepareGeometryChange();
+    d_ptr->pointSize = pointSize;
+}
+
+void DocumentPageItem::OnLayoutReady()
+{
+    update();
 }
 
 int DocumentPageItem::Number() const
@@ -115,67 +185,82 @@ int DocumentPageItem::Number() const
 
 void DocumentPageItem::hoverMoveEvent(QGraphicsSceneHoverEvent* event)
 {
-    updateCurrentLink(d_ptr->document->link(d_ptr->number, event->pos()));
-    updateCursorShape(event->pos());
+    const DocumentHit hit = d_ptr->document->hitTest(d_ptr->number, event->pos(), hoverLoD());
+    updateCurrentLink(hit.Link);
+    updateCursorShape(hit);
     QGraphicsItem::hoverMoveEvent(event);
 }
 
 void DocumentPageItem::hoverLeaveEvent(QGraphicsSceneHoverEvent* event)
 {
-    updateCurrentLink(std::nullopt);
-    updateCursorShape();
+    updateCurrentLink(-1);
+    updateCursorShape({});
     QGraphicsItem::hoverLeaveEvent(event);
 }
 
 void DocumentPageItem::mouseMoveEvent(QGraphicsSceneMouseEvent* event)
 {
-    updateCurrentLink(d_ptr->document->link(d_ptr->number, event->pos()));
-    updateCursorShape(event->pos());
+    const DocumentHit hit = d_ptr->document->hitTest(d_ptr->number, event->pos(), hoverLoD());
+    updateCurrentLink(hit.Link);
+    updateCursorShape(hit);
     QGraphicsItem::mouseMoveEvent(event);
 }
 
 void DocumentPageItem::mouseReleaseEvent(QGraphicsSceneMouseEvent* event)
 {
-    if (const auto link = d_ptr->document->link(d_ptr->number, event->pos()); link)
-        d_ptr->feedback->linkPressed(*link);
+    const DocumentHit hit = d_ptr->document->hitTest(d_ptr->number, event->pos(), hoverLoD());
+
+    if (hit.Type == DocumentHit::Kind::Link)
+    {
+        if (const auto link = d_ptr->document->link(d_ptr->number, hit.Link); link)
+            d_ptr->feedback->linkPressed(*link);
+    }
 
-    updateCursorShape(event->pos());
+    updateCursorShape(hit);
     QGraphicsItem::mouseReleaseEvent(event);
 }
 
-void DocumentPageItem::updateCurrentLink(const std::optional<DocumentLink>& link)
+void DocumentPageItem::updateCurrentLink(const int32_t link)
 {
-    const auto equals = [](const std::optional<DocumentLink>& first, const std::optional<DocumentLink>& second) -> bool
-    {
-        // TODO: optimize
-        const QList<QRectF> f = first.has_value() ? first->geometry() : QList<QRectF> {};
-        const QList<QRectF> s = second.has_value() ? second->geometry() : QList<QRectF> {};
-        return f == s;
-    };
-
-    if (equals(d_ptr->currentLink, link))
+    if (d_ptr->currentLink == link)
         return;
 
     d_ptr->currentLink = link;
+    d_ptr->currentLinkGeometry.clear();
+
+    if (link != -1)
+    {
+        if (const auto current = d_ptr->document->link(d_ptr->number, link); current)
+            d_ptr->currentLinkGeometry = current->geometry();
+    }
+
     update();
 }
 
-void DocumentPageItem::updateCursorShape(std::optional<QPointF> pos)
+uint8_t DocumentPageItem::hoverLoD() const
 {
-    if (!pos)
-    {
-        unsetCursor();
-    }
-    else if (d_ptr->currentLink)
-    {
-        setCursor(Qt::CursorShape::PointingHandCursor);
-    }
-    else if (d_ptr->document->textHit(d_ptr->number, *pos))
-    {
-        setCursor(Qt::CursorShape::IBeamCursor);
-    }
-    else
+    // Lines are barely readable when zoomed out, so there is no need to be precise
+    constexpr qreal zoomedOutScale = 0.5;
+
+    return d_ptr->paintScale < zoomedOutScale
+        ? DocumentTextLoD::Block
+        : DocumentTextLoD::Line;
+}
+
+void DocumentPageItem::updateCursorShape(const DocumentHit& hit)
+{
+    switch (hit.Type)
     {
-        unsetCursor();
+        case DocumentHit::Kind::Link:
+            setCursor(Qt::CursorShape::PointingHandCursor);
+            break;
+
+        case DocumentHit::Kind::Text:
+            setCursor(Qt::CursorShape::IBeamCursor);
+            break;
+
+        case DocumentHit::Kind::None:
+            unsetCursor();
+            break;
     }
 }
@@ -4,6 +4,10 @@
 
 class DocumentFacade;
 class DocumentLink;
+class PagePixmapCache;
+struct DocumentHit;
+struct DocumentRenderFeedback;
+struct DocumentTextSelection;
 
 class DocumentPageItem : public QGraphicsItem
 {
@@ -14,15 +18,20 @@ public:
         virtual void linkPressed(const DocumentLink&) = 0;
     };
 
-    DocumentPageItem(const std::shared_ptr<DocumentFacade>& document, Feedback* feedback, int number);
+    DocumentPageItem(const std::shared_ptr<DocumentFacade>& document, Feedback* feedback, DocumentRenderFeedback* renderFeedback, PagePixmapCache* pixmaps, const DocumentTextSelection* selection, int number);
     ~DocumentPageItem() override;
 
     QRectF boundingRect() const override;
 
     void paint(QPainter* painter, const QStyleOptionGraphicsItem* option, QWidget* widget = nullptr) override;
 
-    void SetSelectionRect(const QRectF& rect);
-    QString GetSelectedText() const;
+    // Repaints the changed part of the selection, the null rectangle means the whole page
+    void UpdateSelection(const QRectF& rect);
+
+    // Takes the page size again, it might have been a placeholder while the document was loading
+    void UpdateGeometry();
+
+    void OnLayoutReady();
 
     int Number() const;
 
@@ -34,8 +43,10 @@ protected:
     void mouseReleaseEvent(QGraphicsSceneMouseEvent* mouseEvent) override;
 
 private:
-    void updateCurrentLink(const std::optional<DocumentLink>& link);
-    void updateCursorShape(std::optional<QPointF> pos = std::nullopt);
+    void updateCurrentLink(int32_t link);
+    void drawImage(QPainter* painter, const QImage& image, const QRectF& exposed) const;
+    void updateCursorShape(const DocumentHit& hit);
+    uint8_t hoverLoD() const;
 
     struct Private;
     std::unique_ptr<Private> d_ptr;
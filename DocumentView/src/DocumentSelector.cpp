@@ -1,6 +1,9 @@
 #include "DocumentSelector.h"
 
 #include <QMouseEvent>
+#include <QApplication>
+
+#include <Document/API/DocumentParser.h>
 
 #include "DocumentView.h"
 #include "DocumentPageItem.h"
@@ -26,6 +29,10 @@ bool DocumentSelector::eventFilter(QObject* object, QEvent* event)
             if (Q_LIKELY(!m_start))
                 onPressed(pos);
         }
+        else if (mouse->type() == QEvent::MouseButtonDblClick && mouse->button() == Qt::LeftButton)
+        {
+            onDoubleClicked(pos);
+        }
         else if (mouse->type() == QEvent::MouseButtonRelease && mouse->button() == Qt::LeftButton)
         {
             if (Q_LIKELY(m_start))
@@ -43,11 +50,19 @@ bool DocumentSelector::eventFilter(QObject* object, QEvent* event)
 
 void DocumentSelector::onPressed(const QPoint point)
 {
+    const bool tripleClick = m_doubleClickTimer.isValid() && m_doubleClickTimer.elapsed() < QApplication::doubleClickInterval();
+    m_doubleClickTimer.invalidate();
+
     m_start = m_view->mapToScene(point);
+    anchor(*m_start, tripleClick ? DocumentTextLoD::Line : DocumentTextLoD::Char);
+}
+
+void DocumentSelector::onDoubleClicked(const QPoint point)
+{
+    m_doubleClickTimer.start();
 
-    for (const auto item : m_view->items())
-        if (const auto page = dynamic_cast<DocumentPageItem*>(item); page)
-            page->SetSelectionRect({});
+    m_start = m_view->mapToScene(point);
+    anchor(*m_start, DocumentTextLoD::Word);
 }
 
 void DocumentSelector::onReleased(QPoint)
@@ -57,22 +72,29 @@ void DocumentSelector::onReleased(QPoint)
 
 void DocumentSelector::onMoved(const QPoint point) const
 {
-    // NOTE: this progressive selection method is quite inefficient due to selection from the very beginning on every update.
-    // TODO: provide stateful selection API to make it truly progressive.
+    const auto selection = m_view->selection();
+    const auto scenePos = m_view->mapToScene(point);
 
-    const auto first = *m_start;
-    const auto second = m_view->mapToScene(point);
-    const auto selectionRect = QRectF(first, second).normalized();
+    if (const auto page = pageAt(scenePos); selection && page)
+        m_view->updateSelection(selection->moveCursor(page->Number(), page->mapFromScene(scenePos)));
+}
 
-    for (const auto item : m_view->items())
-        if (const auto page = dynamic_cast<DocumentPageItem*>(item); page)
-        {
-            const QRectF sceneIntersectionRect = selectionRect.intersected(page->sceneBoundingRect());
+void DocumentSelector::anchor(const QPointF scenePos, const uint8_t lod) const
+{
+    const auto selection = m_view->selection();
 
-            if (sceneIntersectionRect.isNull())
-                continue;
+    if (!selection)
+        return;
 
-            const QRectF pageIntersectionRect = page->mapRectFromScene(sceneIntersectionRect);
-            page->SetSelectionRect(pageIntersectionRect);
-        }
+    if (const auto page = pageAt(scenePos); page)
+        m_view->updateSelection(selection->setAnchor(page->Number(), page->mapFromScene(scenePos), lod));
+    else
+        m_view->updateSelection(selection->clear());
+}
+
+DocumentPageItem* DocumentSelector::pageAt(const QPointF scenePos) const
+{
+    // Vertically nearest page, so dragging over margins keeps selecting
+    const int number = m_view->pageAt(scenePos);
+    return number != -1 ? dynamic_cast<DocumentPageItem*>(m_view->page(number)) : nullptr;
 }
@@ -10,6 +10,7 @@
 #include <Document/API/DocumentRenderer.h>
 
 #include "DocumentPageItem.h"
+#include "PagePixmapCache.h"
 
 struct RenderFeedback : DocumentRenderFeedback
 {
@@ -19,6 +20,9 @@ struct RenderFeedback : DocumentRenderFeedback
     {
         const auto item = _view->page(page);
 
+        if (!item)
+            return false;
+
         const QRect portRect = _view->viewport()->rect();
         const QRectF sceneRect = _view->mapToScene(portRect).boundingRect();
         const QRectF itemRect = item->mapRectFromScene(sceneRect);
@@ -28,14 +32,31 @@ struct RenderFeedback : DocumentRenderFeedback
 
     void imageReady(const int page) const final
     {
-        const auto item = _view->page(page);
-        item->update();
+        if (const auto item = _view->page(page); item)
+            item->update();
     }
 
 private:
     DocumentView* _view;
 };
 
+struct ParserFeedback : DocumentParserFeedback
+{
+    explicit ParserFeedback(DocumentView* view) : _view(view){}
+
+    void layoutReady(const int page) const final
+    {
+        if (const auto item = dynamic_cast<DocumentPageItem*>(_view->page(page)); item)
+            item->OnLayoutReady();
+
+        // Selection ends might have been placed before their layouts were built
+        _view->updateSelection(_view->selection()->refresh());
+    }
+
+private:
+    DocumentView* const _view;
+};
+
 struct PageItemFeedback : DocumentPageItem::Feedback
 {
     explicit PageItemFeedback(DocumentView* view) : _view(view){}
@@ -74,43 +95,79 @@ struct DocumentView::Private
 {
     explicit Private(DocumentView* q)
         : feedback(new PageItemFeedback(q))
+        , renderFeedback(new RenderFeedback(q))
+        , parserFeedback(new ParserFeedback(q))
+        , pixmaps(256 /*MiB*/ * 1024 /*KiB*/ * 1024 /*B*/)
     {}
 
+    ~Private()
+    {
+        detach();
+    }
+
+    void detach() const
+    {
+        if (!document)
+            return;
+
+        document->removeRenderFeedback(renderFeedback.get());
+        document->removeParserFeedback(parserFeedback.get());
+    }
+
     const std::unique_ptr<DocumentPageItem::Feedback> feedback;
+    const std::unique_ptr<DocumentRenderFeedback> renderFeedback;
+    const std::unique_ptr<DocumentParserFeedback> parserFeedback;
+
+    // NOTE: page items keep display format copies of their images here, QPixmapCache's default limit fits hardly one page
+    PagePixmapCache pixmaps;
 
     std::shared_ptr<DocumentFacade> document;
+    std::unique_ptr<DocumentTextSelection> selection;
     QHash<int, DocumentPageItem*> pages;
+    QList<QRectF> pageRects; // scene rectangles, ordered by page number and position
 };
 
 DocumentView::DocumentView(QWidget* parent)
     : QGraphicsView(parent)
     , d(new Private(this))
-{}
+{
+    // Scrolling moves the already painted pixels and repaints only the exposed strip
+    setViewportUpdateMode(MinimalViewportUpdate);
+    setCacheMode(CacheBackground);
+    setOptimizationFlags(DontAdjustForAntialiasing);
+}
 
 DocumentView::~DocumentView(){}
 
+void DocumentView::setPixmapCacheLimit(const qsizetype bytes)
+{
+    d->pixmaps.setMaxCost(bytes);
+}
+
+qsizetype DocumentView::pixmapCacheLimit() const
+{
+    return d->pixmaps.maxCost();
+}
+
 void DocumentView::setDocument(const std::shared_ptr<DocumentFacade>& document)
 {
+    d->detach();
+
     d->document = document;
-    d->document->setRenderFeedback(new RenderFeedback(this));
+    d->selection = document->textSelection();
+    d->document->addRenderFeedback(d->renderFeedback.get());
+    d->document->addParserFeedback(d->parserFeedback.get());
 
     auto* scene = new QGraphicsScene();
     scene->setBackgroundBrush(palette().brush(QPalette::Dark));
 
-    constexpr auto documentMargins = 6;
-
-    qreal yCursor = documentMargins;
-    qreal maxPageWidth = std::numeric_limits<qreal>::min();
+    d->pages.clear();
+    d->pixmaps.clear();
+    d->pageRects.clear();
 
     for (int page = 0; page < document->pageCount(); ++page)
     {
-        QSizeF pagePointSize = document->pageSize(page);
-
-        const auto item = new DocumentPageItem(document, d->feedback.get(), page);
-        item->setPos(documentMargins, yCursor);
-
-        yCursor += pagePointSize.height() + documentMargins;
-        maxPageWidth = std::max(maxPageWidth, pagePointSize.width());
+        const auto item = new DocumentPageItem(document, d->feedback.get(), d->renderFeedback.get(), &d->pixmaps, d->selection.get(), page);
 
         // NOTE: According to the performance profiler, this causes large lags when scaling large
         // const auto shadowEffect = new QGraphicsDropShadowEffect();
@@ -121,26 +178,110 @@ void DocumentView::setDocument(const std::shared_ptr<DocumentFacade>& document)
 
         scene->addItem(item);
         d->pages.insert(page, item);
+        d->pageRects.append(QRectF());
     }
 
     setScene(scene);
-    setSceneRect(0, 0, maxPageWidth + 2 * documentMargins, yCursor);
+    updatePageGeometry(0);
 
     centerOn(0, 0);
     setTransformationAnchor(AnchorUnderMouse);
 }
 
+void DocumentView::updatePageGeometry(const int fromPage)
+{
+    constexpr auto documentMargins = 6;
+
+    auto& rects = d->pageRects;
+    const int first = std::clamp(fromPage, 0, static_cast<int>(rects.size()));
+
+    qreal yCursor = first > 0 ? rects[first - 1].bottom() + documentMargins : documentMargins;
+
+    for (int page = first; page < rects.size(); ++page)
+    {
+        const auto item = d->pages[page];
+        item->UpdateGeometry();
+        item->setPos(documentMargins, yCursor);
+
+        rects[page] = item->sceneBoundingRect();
+        yCursor = rects[page].bottom() + documentMargins;
+    }
+
+    qreal maxPageWidth = std::numeric_limits<qreal>::min();
+
+    for (const QRectF& rect : std::as_const(rects))
+        maxPageWidth = std::max(maxPageWidth, rect.width());
+
+    setSceneRect(0, 0, maxPageWidth + 2 * documentMargins, yCursor);
+}
+
 QString DocumentView::getSelectedText() const
 {
-    QString text;
+    return d->selection ? d->selection->text() : QString();
+}
+
+DocumentTextSelection* DocumentView::selection() const
+{
+    return d->selection.get();
+}
+
+void DocumentView::updateSelection(const DocumentDirtyRegion& region) const
+{
+    for (const auto& [page, rect] : region)
+    {
+        if (const auto item = d->pages.value(page); item)
+            item->UpdateSelection(rect);
+    }
+}
+
+QList<int> DocumentView::pagesIn(const QRectF& sceneRect) const
+{
+    const auto& rects = d->pageRects;
+    const QRectF rect = sceneRect.normalized();
+
+    const auto first = std::partition_point(rects.begin(), rects.end(), [&rect](const QRectF& page) {
+        return page.bottom() < rect.top();
+    });
+
+    const auto last = std::partition_point(first, rects.end(), [&rect](const QRectF& page) {
+        return page.top() <= rect.bottom();
+    });
+
+    QList<int> pages;
+
+    for (auto it = first; it != last; ++it)
+    {
+        if (it->intersects(rect))
+            pages.append(static_cast<int>(std::distance(rects.begin(), it)));
+    }
+
+    return pages;
+}
+
+int DocumentView::pageAt(const QPointF scenePos) const
+{
+    const auto& rects = d->pageRects;
+
+    if (rects.isEmpty())
+        return -1;
+
+    const auto it = std::partition_point(rects.begin(), rects.end(), [&scenePos](const QRectF& page) {
+        return page.bottom() < scenePos.y();
+    });
+
+    if (it == rects.end())
+        return static_cast<int>(rects.size()) - 1;
+
+    const int page = static_cast<int>(std::distance(rects.begin(), it));
 
-    for (const QGraphicsItem* page : d->pages.asKeyValueRange() | std::views::values)
-        text += dynamic_cast<const DocumentPageItem*>(page)->GetSelectedText();
+    // Between two pages
+    if (page > 0 && scenePos.y() < it->top() && it->top() - scenePos.y() > scenePos.y() - rects[page - 1].bottom())
+        return page - 1;
 
-    return text;
+    return page;
 }
 
 QGraphicsItem* DocumentView::page(int i) const
 {
-    return d->pages[i];
+    return d->pages.value(i);
 }
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <QCache>
+#include <QImage>
+#include <QPixmap>
+
+// Display format copies of page images, owned by a view.
+//
+// Pixmaps are keyed by the cache key of their image, which changes whenever the image data does,
+// so a stale copy is never found. Used from the GUI thread only.
+class PagePixmapCache
+{
+public:
+    explicit PagePixmapCache(const qsizetype bytes)
+        : m_cache(bytes)
+    {}
+
+    void setMaxCost(const qsizetype bytes)
+    {
+        m_cache.setMaxCost(bytes);
+    }
+
+    [[nodiscard]] qsizetype maxCost() const
+    {
+        return m_cache.maxCost();
+    }
+
+    // NOTE: the pixmap is returned even if it is too big to be cached
+    QPixmap pixmap(const QImage& image, const qreal pixelRatio)
+    {
+        if (const QPixmap* pixmap = m_cache.object(image.cacheKey()); pixmap)
+            return *pixmap;
+
+        const QPixmap pixmap = convert(image, pixelRatio);
+        (void) m_cache.insert(image.cacheKey(), new QPixmap(pixmap), image.sizeInBytes());
+        return pixmap;
+    }
+
+    [[nodiscard]] static QPixmap convert(const QImage& image, const qreal pixelRatio)
+    {
+        QPixmap pixmap = QPixmap::fromImage(image);
+        pixmap.setDevicePixelRatio(pixelRatio);
+        return pixmap;
+    }
+
+    void clear()
+    {
+        m_cache.clear();
+    }
+
+private:
+    QCache<qint64, QPixmap> m_cache;
+};
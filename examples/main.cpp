@@ -1,8 +1,11 @@
 #include <QApplication>
 #include <QShortcut>
 #include <QClipboard>
+#include <QStandardPaths>
+#include <QFutureWatcher>
 
 #include <Document/API/DocumentFacade.h>
+#include <Document/API/DocumentTask.h>
 
 #include <DocumentView/DocumentView.h>
 #include <DocumentView/DocumentZoomer.h>
@@ -11,21 +14,37 @@
 #include <Document/Pdf/PdfDocument.h>
 #include <Document/Std/StandardDocumentParser.h>
 #include <Document/Std/StandardDocumentRenderer.h>
+#include <Document/Std/StandardDocumentSearch.h>
+
+namespace
+{
+    // The window icon is the first page, rendered without blocking the GUI thread
+    DocumentTask<void> showFirstPageIcon(std::shared_ptr<const Document> document, QWidget* window, DocumentCancelToken token)
+    {
+        const QSizeF size = document->pagePointSize(0);
+        const qreal scale = 64 / std::max(size.width(), size.height());
+
+        if (const std::optional<QImage> image = co_await DocumentAsync::render(document, 0, scale); image && !image->isNull())
+            window->setWindowIcon(QPixmap::fromImage(*image));
+    }
+}
 
 int main(int argc, char** argv)
 {
     QApplication app(argc, argv);
 
     const auto pdf = std::make_shared<PdfDocument>();
-    pdf->load(qEnvironmentVariable("DOCUMENT"));
 
     const auto renderer = std::make_shared<StandardDocumentRenderer>();
     const auto parser = std::make_shared<StandardDocumentParser>();
+    parser->setLayoutStorage(QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/layouts");
+    const auto search = std::make_shared<StandardDocumentSearch>();
+    search->setParser(parser);
 
     const auto document = std::make_shared<DocumentFacade>();
-    document->setDocument(pdf);
     document->setRenderer(renderer);
     document->setParser(parser);
+    document->setSearch(search);
 
     DocumentView view;
 
@@ -38,8 +57,30 @@ int main(int argc, char** argv)
         QGuiApplication::clipboard()->setText(view.getSelectedText(), QClipboard::Clipboard);
     });
 
-    view.setDocument(document);
     view.show();
 
+    DocumentCancelToken iconToken;
+    QObject::connect(&app, &QCoreApplication::aboutToQuit, [&] { iconToken.cancel(); });
+
+    // The view is shown with the first page, the rest of the pages get their sizes in the background
+    QFutureWatcher<int> loading;
+    QObject::connect(&loading, &QFutureWatcher<int>::resultsReadyAt, [&](const int begin, const int)
+    {
+        const int page = loading.resultAt(begin);
+
+        if (page == 0)
+        {
+            document->setDocument(pdf);
+            view.setDocument(document);
+
+            (void) showFirstPageIcon(pdf, &view, iconToken);
+        }
+        else
+        {
+            view.updatePageGeometry(page);
+        }
+    });
+    loading.setFuture(pdf->loadAsync(qEnvironmentVariable("DOCUMENT")));
+
     return QApplication::exec();
 }
@@ -0,0 +1,233 @@
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QImageWriter>
+#include <QMutex>
+#include <QSemaphore>
+#include <QTextStream>
+#include <QThread>
+#include <QThreadPool>
+
+#include <Document/Pdf/PdfDocument.h>
+
+namespace
+{
+    enum class Format { Png, Raw };
+
+    // "1-3,7" (1-based, inclusive) to page indices, nullopt if malformed
+    std::optional<QList<int>> parsePages(const QString& ranges, const int pageCount)
+    {
+        QList<int> pages;
+
+        if (ranges.isEmpty())
+        {
+            for (int page = 0; page < pageCount; ++page)
+                pages.append(page);
+
+            return pages;
+        }
+
+        for (const QString& range : ranges.split(',', Qt::SkipEmptyParts))
+        {
+            const QStringList bounds = range.split('-');
+            bool firstOk = false, lastOk = bounds.size() == 1;
+
+            const int first = bounds.front().trimmed().toInt(&firstOk);
+            const int last = bounds.size() == 2 ? bounds.back().trimmed().toInt(&lastOk) : first;
+
+            if (!firstOk || !lastOk || bounds.size() > 2 || first < 1 || last > pageCount || first > last)
+                return std::nullopt;
+
+            for (int page = first; page <= last; ++page)
+                pages.append(page - 1);
+        }
+
+        return pages;
+    }
+
+    // Page pixels are rendered right into reused buffers, there is one per image in flight
+    class BufferPool
+    {
+    public:
+        std::shared_ptr<QByteArray> acquire(const qsizetype size)
+        {
+            std::unique_ptr<QByteArray> buffer;
+            {
+                QMutexLocker lock(&m_free->Mutex);
+
+                if (!m_free->Buffers.empty())
+                {
+                    buffer = std::move(m_free->Buffers.back());
+                    m_free->Buffers.pop_back();
+                }
+            }
+
+            if (!buffer)
+                buffer = std::make_unique<QByteArray>();
+
+            buffer->resize(size); // keeps the capacity
+            buffer->detach();
+
+            // The free list outlives the pool while buffers are still in use
+            return std::shared_ptr<QByteArray>(buffer.release(), [free = m_free](QByteArray* buffer)
+            {
+                QMutexLocker lock(&free->Mutex);
+                free->Buffers.emplace_back(buffer);
+            });
+        }
+
+    private:
+        struct FreeList
+        {
+            QMutex Mutex;
+            std::vector<std::unique_ptr<QByteArray>> Buffers;
+        };
+
+        std::shared_ptr<FreeList> m_free = std::make_shared<FreeList>();
+    };
+
+    bool writeImage(const QImage& image, const QString& path, const Format format)
+    {
+        if (format == Format::Png)
+            return QImageWriter(path, "png").write(image);
+
+        // The image is already tightly packed RGBA
+        QFile file(path);
+        return file.open(QIODevice::WriteOnly) && file.write(reinterpret_cast<const char*>(image.constBits()), image.sizeInBytes()) == image.sizeInBytes();
+    }
+}
+
+// Renders document pages to image files, rendering and encoding in parallel
+int main(int argc, char** argv)
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("document-export");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Rasterizes document pages to PNG or raw RGBA files.");
+    parser.addHelpOption();
+    parser.addPositionalArgument("document", "PDF file to export.");
+
+    const QCommandLineOption pagesOption({ "p", "pages" }, "Pages to export, e.g. 1-3,7. All pages by default.", "ranges");
+    const QCommandLineOption dpiOption({ "d", "dpi" }, "Resolution, 96 by default.", "dpi", "96");
+    const QCommandLineOption formatOption({ "f", "format" }, "Output format: png (default) or raw.", "format", "png");
+    const QCommandLineOption outputOption({ "o", "output" }, "Output directory, the current one by default.", "directory", ".");
+    const QCommandLineOption jobsOption({ "j", "jobs" }, "Pages processed in parallel, the number of cores by default.", "count", QString::number(QThread::idealThreadCount()));
+
+    parser.addOptions({ pagesOption, dpiOption, formatOption, outputOption, jobsOption });
+    parser.process(app);
+
+    QTextStream out(stdout);
+    QTextStream err(stderr);
+
+    if (parser.positionalArguments().size() != 1)
+        parser.showHelp(1);
+
+    bool dpiOk = false, jobsOk = false;
+    const qreal dpi = parser.value(dpiOption).toDouble(&dpiOk);
+    const int jobs = parser.value(jobsOption).toInt(&jobsOk);
+    const QString formatName = parser.value(formatOption);
+
+    if (!dpiOk || dpi <= 0 || !jobsOk || jobs < 1 || (formatName != "png" && formatName != "raw"))
+        parser.showHelp(1);
+
+    const Format format = formatName == "png" ? Format::Png : Format::Raw;
+
+    // Renders run on the global pool, encoding and writing on its own one
+    QThreadPool::globalInstance()->setMaxThreadCount(jobs);
+
+    // Links are never asked for, and the document is not fingerprinted unless asked either
+    PdfDocument document;
+    document.setLinkPassEnabled(false);
+    document.load(parser.positionalArguments().front());
+
+    const int pageCount = static_cast<int>(document.pageCount());
+
+    if (pageCount == 0)
+    {
+        err << "Failed to load the document" << Qt::endl;
+        return 1;
+    }
+
+    const auto pages = parsePages(parser.value(pagesOption), pageCount);
+
+    if (!pages)
+    {
+        err << "Invalid page ranges, the document has " << pageCount << " pages" << Qt::endl;
+        return 1;
+    }
+
+    const QDir output(parser.value(outputOption));
+
+    if (!output.mkpath("."))
+    {
+        err << "Failed to create the output directory" << Qt::endl;
+        return 1;
+    }
+
+    QThreadPool encoders;
+    encoders.setMaxThreadCount(jobs);
+
+    // Bounds the number of images held in memory: rendering, waiting for encoding or being written
+    const int maxInFlight = 2 * jobs;
+    QSemaphore inFlight(maxInFlight);
+
+    std::atomic_int failed = 0;
+    QMutex errMutex;
+
+    BufferPool buffers;
+    const QImage::Format pixelFormat = format == Format::Png ? QImage::Format_ARGB32 : QImage::Format_RGBA8888;
+
+    const qreal scale = dpi / 72 /*points per inch*/;
+    const QString suffix = format == Format::Png ? "png" : "rgba";
+    const int digits = static_cast<int>(QString::number(pageCount).size());
+
+    QElapsedTimer timer;
+    timer.start();
+
+    for (const int page : *pages)
+    {
+        inFlight.acquire();
+
+        const QString path = output.filePath(QString("page-%1.%2").arg(page + 1, digits, 10, QChar('0')).arg(suffix));
+
+        const QSize size = (document.pagePointSize(page) * scale).toSize();
+        const qsizetype bytesPerLine = size.width() * 4;
+        const auto buffer = buffers.acquire(bytesPerLine * size.height());
+
+        const DocumentRenderTarget target { reinterpret_cast<uchar*>(buffer->data()), size, bytesPerLine, pixelFormat };
+
+        document.render(page, target)
+            .then(&encoders, [&inFlight, &failed, &err, &errMutex, path, format, target, buffer]
+            {
+                const QImage image(target.Data, target.Size.width(), target.Size.height(), target.BytesPerLine, target.Format);
+
+                if (image.isNull() || !writeImage(image, path, format))
+                {
+                    ++failed;
+
+                    QMutexLocker lock(&errMutex);
+                    err << "Failed to export " << path << Qt::endl;
+                }
+
+                inFlight.release();
+            })
+            .onCanceled([&inFlight, &failed, buffer]
+            {
+                ++failed;
+                inFlight.release();
+            });
+    }
+
+    inFlight.acquire(maxInFlight);
+
+    const qreal seconds = std::max<qreal>(timer.elapsed(), 1) / 1000;
+    const qsizetype exported = pages->size() - failed;
+
+    out << "Exported " << exported << " of " << pages->size() << " pages in " << seconds << " s, "
+        << exported / seconds << " pages/s" << Qt::endl;
+
+    return failed ? 1 : 0;
+}